@@ -7,5 +7,19 @@
 #define O_WRONLY  0x001
 #define O_RDWR    0x002
 #define O_CREATE  0x200
+#define O_NONBLOCK 0x400  // pipes and console: fail instead of waiting
+
+// fcntl commands
+
+#define F_GETFL   1
+#define F_SETFL   2  // only O_NONBLOCK can be changed
+
+// Access-pattern advice for fadvise
+
+#define FADV_NORMAL     0
+#define FADV_RANDOM     1  // no readahead
+#define FADV_SEQUENTIAL 2  // read ahead, drop pages once read
+#define FADV_WILLNEED   3  // read the range in now and pin the file
+#define FADV_DONTNEED   4  // unpin and drop the range's pages
 
 #endif //_FCNTL_H_
@@ -0,0 +1,14 @@
+#ifndef _MMAN_H_
+#define _MMAN_H_
+
+// Memory-mapped files: mmap() and munmap().
+
+#define PROT_READ   0x1
+#define PROT_WRITE  0x2
+
+#define MAP_SHARED  0x1  // stores reach the file and other mappers
+#define MAP_PRIVATE 0x2  // stores go to a private copy
+
+#define MAP_FAILED  ((void*)-1)
+
+#endif // _MMAN_H_
@@ -3,17 +3,26 @@
 
 // System parameters
 
-#define NPROC        64  // maximum number of processes
+#define NPROC        64  // processes reported by getpinfo()
 #define KSTACKSIZE 4096  // size of per-process kernel stack
 #define NCPU          8  // maximum number of CPUs
-#define NOFILE       16  // open files per process
-#define NFILE       100  // open files per system
+#define NOFILE       16  // initial size of a process's fd table
+#define NOFILEMAX  1024  // open files per process (32*32 for the fd bitmap)
 #define NBUF         10  // size of disk block cache
-#define NINODE       50  // maximum number of active i-nodes
 #define NDEV         10  // maximum major device number
 #define ROOTDEV       1  // device number of file system root disk
+#define NBLKDEV       5  // block devices: 4 IDE drives, then the RAM disk
+#define RAMDEV        4  // device number of the RAM disk
+#define RAMDISKSIZE 2048 // RAM disk sectors
+#define NMOUNT        4  // mounted file systems besides the root
 #define USERTOP  0xA0000 // end of user address space
 #define PHYSTOP  0x1000000 // use phys mem up to here as free pool
 #define MAXARG       32  // max exec arguments
+#define MAXPATH     128  // longest path name argument, with its nul
+#define NVMA          8  // mmap regions per process
+#define NSHM         16  // shared memory segments
+#define NSHMPG       32  // pages in a shared memory segment
+#define NPOLL        64  // fds in one poll() call
+#define KLOGSIZE  16384  // per-CPU kernel log ring (a power of 2)
 
 #endif // _PARAM_H_
@@ -0,0 +1,18 @@
+#ifndef _POLL_H_
+#define _POLL_H_
+
+// Waiting for several file descriptors with poll().
+
+#define POLLIN   0x1   // data to read
+#define POLLOUT  0x4   // room to write
+#define POLLERR  0x8   // pipe has no reader
+#define POLLHUP  0x10  // pipe has no writer
+#define POLLNVAL 0x20  // fd not open
+
+struct pollfd {
+  int fd;         // ignored if negative
+  short events;   // POLLIN and/or POLLOUT
+  short revents;  // set by poll()
+};
+
+#endif // _POLL_H_
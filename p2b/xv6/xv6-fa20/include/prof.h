@@ -0,0 +1,22 @@
+#ifndef _PROF_H_
+#define _PROF_H_
+
+// Sampling profiler.  While it runs, every clock interrupt on
+// every cpu records where it landed; see profctl() and profread().
+
+#define PROFDEPTH 4      // kernel caller pcs kept per sample
+#define NPROFSAMPLE 512  // samples kept per cpu
+
+struct profsample {
+  uint eip;               // interrupted pc
+  int pid;                // running process, or 0 if none
+  uint kernel;            // 1 if eip is in the kernel
+  uint pcs[PROFDEPTH];    // kernel callers of eip, 0-terminated
+};
+
+// profctl() commands
+#define PROF_START  1   // start sampling
+#define PROF_STOP   2   // stop sampling; returns samples taken
+#define PROF_RESET  3   // discard all samples
+
+#endif // _PROF_H_
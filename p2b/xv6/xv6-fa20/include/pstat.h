@@ -15,4 +15,13 @@ struct pstat {
   int qtail[NPROC][4]; // total num times moved to tail of queue (e.g., setpri, end of timeslice, waking)
 };
 
+// Snapshot of struct pstat that the kernel republishes every
+// clock tick into a read-only page; see mappinfo().
+// seq is odd while the kernel is rewriting st, so a reader
+// retries until it sees the same even seq before and after.
+struct pstatpage {
+  volatile uint seq;
+  struct pstat st;
+};
+
 #endif // _PSTAT_H_
\ No newline at end of file
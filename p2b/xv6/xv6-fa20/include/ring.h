@@ -0,0 +1,44 @@
+#ifndef _RING_H_
+#define _RING_H_
+
+// Batched system call ring, one page shared between a process
+// and the kernel; see ringsetup() and ringenter().
+//
+// The process fills sq[sqtail % RING_ENTRIES] and bumps sqtail;
+// ringenter() runs the entries queued when it is called, in order,
+// advancing sqhead, and posts each result at cq[cqtail %
+// RING_ENTRIES].  The process consumes completions by bumping
+// cqhead.  ringenter() stops early if the completion queue is full,
+// after RING_ENTRIES entries, or if the process is killed.
+
+#define RING_ENTRIES 128
+
+// Operations
+#define RING_READ   1   // read(fd, addr, n)
+#define RING_WRITE  2   // write(fd, addr, n)
+#define RING_OPEN   3   // open(addr, n)
+#define RING_CLOSE  4   // close(fd)
+
+struct sqe {
+  int op;      // RING_*
+  int fd;
+  uint addr;   // buffer, or path for RING_OPEN
+  int n;       // byte count, or mode for RING_OPEN
+  uint data;   // copied to the completion untouched
+};
+
+struct cqe {
+  uint data;   // from the sqe
+  int res;     // what the system call would have returned
+};
+
+struct ring {
+  volatile uint sqhead;   // next entry the kernel will run
+  volatile uint sqtail;   // next free submission slot
+  volatile uint cqhead;   // next completion the process will read
+  volatile uint cqtail;   // next completion slot the kernel will fill
+  struct sqe sq[RING_ENTRIES];
+  struct cqe cq[RING_ENTRIES];
+};
+
+#endif // _RING_H_
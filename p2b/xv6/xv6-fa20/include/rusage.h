@@ -0,0 +1,19 @@
+#ifndef _RUSAGE_H_
+#define _RUSAGE_H_
+
+// Per-process resource usage, returned by getrusage().
+
+#define RUSAGE_SELF      0   // the calling process
+#define RUSAGE_CHILDREN  -1  // all waited-for descendants
+
+struct rusage {
+  uint utime;     // clock ticks taken in user mode
+  uint stime;     // clock ticks taken in the kernel
+  uint inblock;   // disk blocks read
+  uint oublock;   // disk blocks written
+  uint nvcsw;     // voluntary context switches (blocked)
+  uint nivcsw;    // involuntary context switches (preempted)
+  uint minflt;    // page faults
+};
+
+#endif // _RUSAGE_H_
@@ -27,5 +27,31 @@
 #define SYS_getpri 22
 #define SYS_setpri 23
 #define SYS_getpinfo 24
+#define SYS_getsysstat 25
+#define SYS_mappinfo 26
+#define SYS_profctl 27
+#define SYS_profread 28
+#define SYS_tracectl 29
+#define SYS_traceread 30
+#define SYS_getrusage 31
+#define SYS_ringsetup 32
+#define SYS_ringenter 33
+#define SYS_readv 34
+#define SYS_writev 35
+#define SYS_pread 36
+#define SYS_pwrite 37
+#define SYS_mmap   38
+#define SYS_munmap 39
+#define SYS_shmat  40
+#define SYS_shmdt  41
+#define SYS_clone  42
+#define SYS_join   43
+#define SYS_futexwait 44
+#define SYS_futexwake 45
+#define SYS_fadvise 46
+#define SYS_fcntl  47
+#define SYS_poll   48
+#define SYS_dmesg  49
+#define SYS_mount  50
 
 #endif // _SYSCALL_H_
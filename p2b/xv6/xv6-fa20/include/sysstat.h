@@ -0,0 +1,16 @@
+#ifndef _SYSSTAT_H_
+#define _SYSSTAT_H_
+
+// Per-syscall instrumentation, kept per process (struct proc) and
+// per CPU (struct cpu).  Shared with user programs via getsysstat().
+
+#define NSYSCALL  64  // syscall numbers tracked (see syscall.h)
+#define NSYSHIST  32  // log2 latency buckets
+
+struct sysstat {
+  uint count[NSYSCALL];            // calls entered
+  uint64 cycles[NSYSCALL];         // TSC cycles spent in completed calls
+  uint hist[NSYSCALL][NSYSHIST];   // hist[n][b]: calls taking [2^b, 2^(b+1)) cycles
+};
+
+#endif // _SYSSTAT_H_
@@ -0,0 +1,37 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+// Kernel event trace.  While tracing is on, tracepoints append
+// timestamped events to a per-cpu ring; see tracectl() and
+// traceread().
+
+#define NTRACEEV 1024  // events kept per cpu
+
+struct traceev {
+  uint64 tsc;     // rdtsc() when the event happened
+  ushort type;    // TR_*
+  ushort cpu;     // index in cpus[]
+  int pid;        // running process, or 0 in the scheduler
+  uint arg;       // depends on type, see below
+};
+
+// Event types and their arg
+#define TR_SWITCH    1   // scheduler switches to a process; arg = pid
+#define TR_SCHED     2   // process gives up the cpu; arg = new state
+#define TR_SLEEP     3   // process sleeps; arg = chan
+#define TR_WAKEUP    4   // process made runnable; arg = its pid
+#define TR_IOSTART   5   // disk request queued; arg = sector|TR_WRITE
+#define TR_IODONE    6   // disk request finished; arg = sector|TR_WRITE
+#define TR_BGET      7   // buffer locked; arg = sector
+#define TR_BRELSE    8   // buffer released; arg = sector
+#define TR_LOCKWAIT  9   // spinlock busy, spinning; arg = lock address
+#define TR_LOCKGOT   10  // spinlock acquired after spinning; arg = lock
+
+#define TR_WRITE  0x80000000  // disk request is a write
+
+// tracectl() commands
+#define TRACE_START  1   // start tracing
+#define TRACE_STOP   2   // stop tracing; returns events recorded
+#define TRACE_RESET  3   // discard all events
+
+#endif // _TRACE_H_
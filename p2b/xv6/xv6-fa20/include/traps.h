@@ -28,6 +28,7 @@
 // These are arbitrarily chosen, but with care not to overlap
 // processor defined exceptions or interrupt vectors.
 #define T_SYSCALL       64      // system call
+#define T_SYSENTER      65      // system call via sysenter (not a vector)
 #define T_DEFAULT      500      // catchall
 
 #define T_IRQ0          32      // IRQ 0 corresponds to int T_IRQ
@@ -36,6 +37,7 @@
 #define IRQ_KBD          1
 #define IRQ_COM1         4
 #define IRQ_IDE         14
+#define IRQ_IDE2        15
 #define IRQ_ERROR       19
 #define IRQ_SPURIOUS    31
 
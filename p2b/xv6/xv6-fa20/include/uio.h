@@ -0,0 +1,13 @@
+#ifndef _UIO_H_
+#define _UIO_H_
+
+// Scatter/gather buffer list for readv() and writev().
+
+#define IOV_MAX 16  // most buffers in one call
+
+struct iovec {
+  void *base;
+  uint len;
+};
+
+#endif // _UIO_H_
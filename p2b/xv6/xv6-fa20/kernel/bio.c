@@ -12,6 +12,9 @@
 // * Do not use the buffer after calling brelse.
 // * Only one process at a time can use a buffer,
 //     so do not keep them longer than necessary.
+//
+// Each device number names a struct blkdev registered by its
+// driver (ide.c, ramdisk.c), which blkrw() hands transfers to.
 // 
 // The implementation uses three state flags internally:
 // * B_BUSY: the block has been returned from bread
@@ -26,6 +29,12 @@
 #include "param.h"
 #include "spinlock.h"
 #include "buf.h"
+#include "blkdev.h"
+#include "mmu.h"
+#include "proc.h"
+#include "trace.h"
+
+static struct blkdev *blkdevs[NBLKDEV];
 
 struct {
   struct spinlock lock;
@@ -55,6 +64,70 @@ binit(void)
   }
 }
 
+// Make d device number dev.  Drivers call this at boot.
+void
+blkregister(uint dev, struct blkdev *d)
+{
+  if(dev >= NBLKDEV || blkdevs[dev])
+    panic("blkregister");
+  blkdevs[dev] = d;
+}
+
+// Is there a device numbered dev?
+int
+blkpresent(uint dev)
+{
+  return dev < NBLKDEV && blkdevs[dev] != 0;
+}
+
+// Return the number of sectors on dev, or 0 if unknown.
+uint
+blksize(uint dev)
+{
+  return blkpresent(dev) ? blkdevs[dev]->size : 0;
+}
+
+// Sync buf with disk. 
+// If B_DIRTY is set, write buf to disk, clear B_DIRTY, set B_VALID.
+// Else if B_VALID is not set, read buf from disk, set B_VALID.
+static void
+blkrw(struct buf *b)
+{
+  struct blkdev *d;
+
+  if(!(b->flags & B_BUSY))
+    panic("blkrw: buf not busy");
+  if((b->flags & (B_VALID|B_DIRTY)) == B_VALID)
+    panic("blkrw: nothing to do");
+  if(!blkpresent(b->dev))
+    panic("blkrw: no such device");
+  d = blkdevs[b->dev];
+
+  if(proc){
+    if(b->flags & B_DIRTY)
+      proc->ru.oublock++;
+    else
+      proc->ru.inblock++;
+  }
+
+  acquire(d->lock);
+  d->submit(d, b);
+  // Wait for request to finish.
+  // Assuming will not sleep too long: ignore proc->killed.
+  while((b->flags & (B_VALID|B_DIRTY)) != B_VALID)
+    sleep(b, d->lock);
+  release(d->lock);
+}
+
+// Called by a driver, holding its lock, when b's transfer is done.
+void
+blkdone(struct buf *b)
+{
+  b->flags |= B_VALID;
+  b->flags &= ~B_DIRTY;
+  wakeup(b);
+}
+
 // Look through buffer cache for sector on device dev.
 // If not found, allocate fresh block.
 // In either case, return locked buffer.
@@ -72,6 +145,7 @@ bget(uint dev, uint sector)
       if(!(b->flags & B_BUSY)){
         b->flags |= B_BUSY;
         release(&bcache.lock);
+        trace(TR_BGET, sector);
         return b;
       }
       sleep(b, &bcache.lock);
@@ -86,6 +160,7 @@ bget(uint dev, uint sector)
       b->sector = sector;
       b->flags = B_BUSY;
       release(&bcache.lock);
+      trace(TR_BGET, sector);
       return b;
     }
   }
@@ -100,7 +175,7 @@ bread(uint dev, uint sector)
 
   b = bget(dev, sector);
   if(!(b->flags & B_VALID))
-    iderw(b);
+    blkrw(b);
   return b;
 }
 
@@ -111,28 +186,67 @@ bwrite(struct buf *b)
   if((b->flags & B_BUSY) == 0)
     panic("bwrite");
   b->flags |= B_DIRTY;
-  iderw(b);
+  blkrw(b);
 }
 
-// Release the buffer b.
-void
-brelse(struct buf *b)
+// Unlock b and move it to the head of the LRU list.  With drop
+// set, empty it and move it to the tail instead, to be reused
+// first.
+static void
+bunlock(struct buf *b, int drop)
 {
-  if((b->flags & B_BUSY) == 0)
-    panic("brelse");
-
   acquire(&bcache.lock);
 
   b->next->prev = b->prev;
   b->prev->next = b->next;
-  b->next = bcache.head.next;
-  b->prev = &bcache.head;
-  bcache.head.next->prev = b;
-  bcache.head.next = b;
+  if(drop){
+    b->next = &bcache.head;
+    b->prev = bcache.head.prev;
+    bcache.head.prev->next = b;
+    bcache.head.prev = b;
+    b->flags &= ~B_VALID;
+  } else {
+    b->next = bcache.head.next;
+    b->prev = &bcache.head;
+    bcache.head.next->prev = b;
+    bcache.head.next = b;
+  }
 
   b->flags &= ~B_BUSY;
+  trace(TR_BRELSE, b->sector);
   wakeup(b);
 
   release(&bcache.lock);
 }
 
+// Release the buffer b.
+void
+brelse(struct buf *b)
+{
+  if((b->flags & B_BUSY) == 0)
+    panic("brelse");
+  bunlock(b, 0);
+}
+
+// Read (or write, if write is set) sector of dev into (or from)
+// data without keeping it in the cache.  File contents go this
+// way: they are cached by page in their inode instead (see
+// ipage() in fs.c).  The transfer goes through the sector's
+// buffer, so it waits for anyone using it and leaves no stale
+// copy behind.
+void
+bdirect(uint dev, uint sector, void *data, int write)
+{
+  struct buf *b;
+
+  b = bget(dev, sector);
+  if(write){
+    memmove(b->data, data, sizeof(b->data));
+    bwrite(b);
+  } else {
+    if(!(b->flags & B_VALID))
+      blkrw(b);
+    memmove(data, b->data, sizeof(b->data));
+  }
+  bunlock(b, 1);
+}
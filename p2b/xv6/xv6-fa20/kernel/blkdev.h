@@ -0,0 +1,17 @@
+#ifndef _BLKDEV_H_
+#define _BLKDEV_H_
+
+// A block device, one per device number, that the buffer cache
+// reads and writes sectors through (see blkrw() in bio.c).
+// submit() starts or queues the transfer of b; when it is done
+// the driver calls blkdone(b).  Both happen holding *lock, which
+// blkrw() sleeps on while it waits.
+struct blkdev {
+  struct spinlock *lock;
+  void (*submit)(struct blkdev*, struct buf*);
+  void *priv;  // driver state
+  int unit;    // driver's number for the device
+  uint size;   // sectors on the device, or 0 if unknown
+};
+
+#endif // _BLKDEV_H_
@@ -18,7 +18,7 @@ char isEmpty(circleQueue *pq) { return (pq->head == -1 || pq->tail == -1); }
  * Add to the back of the queue by inserting after tail node
  */
 int enqueue(circleQueue *pq, int pid) {
-  if (pq->size >= NPROC) {
+  if (pq->size >= NPQSLOT) {
     return -1;
   }
   
@@ -26,7 +26,7 @@ int enqueue(circleQueue *pq, int pid) {
     pq->head++;
     pq->tail++;
   } else {
-    pq->tail = (pq->tail + 1) % NPROC;
+    pq->tail = (pq->tail + 1) % NPQSLOT;
   }
     
   pq->pid[pq->tail] = pid;
@@ -51,7 +51,7 @@ int dequeue(circleQueue *pq) {
     setQueueEmpty(pq);
     // cprintf("setQueueEmpty() h %d t %d s %d pid %d\n", pq->head, pq->tail, pq->size, pq->pid[pq->head]);
   } else {
-    pq->head = (pq->head + 1) % NPROC;
+    pq->head = (pq->head + 1) % NPQSLOT;
   }
   
   pq->size--;
@@ -62,7 +62,7 @@ void setQueueEmpty(circleQueue *pq) {
   pq->head = -1;
   pq->tail = -1;
   pq->size = 0;
-  for (int i = 0; i < NPROC; i++) {
+  for (int i = 0; i < NPQSLOT; i++) {
     pq->pid[i] = 0;
   }
 }
@@ -89,11 +89,11 @@ int swapHead(circleQueue *pq, int pid) {
   
   // pid already at head if only item in line
   if (pq->size == 1)
-    return pid;
+    return pq->pid[pq->head] == pid ? pid : -1;
   
   // find pid in PQ
   int currIndex = -1;
-  for(int i = 0; i < NPROC; i++) {
+  for(int i = 0; i < NPQSLOT; i++) {
     if (pq->pid[i] == pid) {
       currIndex = i;
       break;
@@ -7,8 +7,11 @@
 #include "syscall.h"
 #include "sysfunc.h"
 
+// More slots than processes fit in physical memory.
+#define NPQSLOT 1024
+
 typedef struct {
-   int pid[NPROC]; // store the PIDs in a queue
+   int pid[NPQSLOT]; // store the PIDs in a queue
    int head;
    int tail;
    int size;
@@ -12,8 +12,10 @@
 #include "mmu.h"
 #include "proc.h"
 #include "x86.h"
+#include "poll.h"
 
 static void consputc(int);
+static void cgacursor(void);
 
 static int panicked = 0;
 
@@ -22,8 +24,25 @@ static struct {
   int locking;
 } cons;
 
+// A message being formatted by cprintf(), passed to the kernel
+// log a line at a time.
+struct msg {
+  char buf[128];
+  int n;
+};
+
 static void
-printint(int xx, int base, int sign)
+msgputc(struct msg *m, int c)
+{
+  if(m->n == sizeof(m->buf)){
+    klogwrite(m->buf, m->n);
+    m->n = 0;
+  }
+  m->buf[m->n++] = c;
+}
+
+static void
+printint(struct msg *m, int xx, int base, int sign)
 {
   static char digits[] = "0123456789abcdef";
   char buf[16];
@@ -44,25 +63,26 @@ printint(int xx, int base, int sign)
     buf[i++] = '-';
 
   while(--i >= 0)
-    consputc(buf[i]);
+    msgputc(m, buf[i]);
 }
 
 // Print to the console. only understands %d, %x, %p, %s.
+// The message goes to the kernel log (see klog.c), which klogd
+// copies to the console; until klogd runs, and after a panic,
+// cprintf() copies it out before returning.
 void
 cprintf(char *fmt, ...)
 {
-  int i, c, locking;
+  int i, c;
   uint *argp;
   char *s;
+  struct msg m;
 
-  locking = cons.locking;
-  if(locking)
-    acquire(&cons.lock);
-
+  m.n = 0;
   argp = (uint*)(void*)(&fmt + 1);
   for(i = 0; (c = fmt[i] & 0xff) != 0; i++){
     if(c != '%'){
-      consputc(c);
+      msgputc(&m, c);
       continue;
     }
     c = fmt[++i] & 0xff;
@@ -70,29 +90,47 @@ cprintf(char *fmt, ...)
       break;
     switch(c){
     case 'd':
-      printint(*argp++, 10, 1);
+      printint(&m, *argp++, 10, 1);
       break;
     case 'x':
     case 'p':
-      printint(*argp++, 16, 0);
+      printint(&m, *argp++, 16, 0);
       break;
     case 's':
       if((s = (char*)*argp++) == 0)
         s = "(null)";
       for(; *s; s++)
-        consputc(*s);
+        msgputc(&m, *s);
       break;
     case '%':
-      consputc('%');
+      msgputc(&m, '%');
       break;
     default:
       // Print unknown % sequence to draw attention.
-      consputc('%');
-      consputc(c);
+      msgputc(&m, '%');
+      msgputc(&m, c);
       break;
     }
   }
+  if(m.n > 0)
+    klogwrite(m.buf, m.n);
+
+  if(klogsync() || !cons.locking)
+    klogflush(cons.locking);
+}
 
+// Write n bytes of s to the console, for klogflush().
+void
+consputs(char *s, int n)
+{
+  int i, locking;
+
+  locking = cons.locking;
+  if(locking)
+    acquire(&cons.lock);
+  for(i = 0; i < n; i++)
+    consputc(s[i] & 0xff);
+  cgacursor();
   if(locking)
     release(&cons.lock);
 }
@@ -105,6 +143,7 @@ panic(char *s)
   
   cli();
   cons.locking = 0;
+  uartpolled();
   cprintf("cpu%d: panic: ", cpu->id);
   cprintf(s);
   cprintf("\n");
@@ -120,16 +159,23 @@ panic(char *s)
 #define CRTPORT 0x3d4
 static ushort *crt = (ushort*)0xb8000;  // CGA memory
 
+// Cursor position: col + 80*row.  Kept here and written to the
+// CRT controller once per cprintf() or write, not per character.
+static int crtpos = -1;
+static int crtmoved;
+
 static void
 cgaputc(int c)
 {
   int pos;
   
-  // Cursor position: col + 80*row.
-  outb(CRTPORT, 14);
-  pos = inb(CRTPORT+1) << 8;
-  outb(CRTPORT, 15);
-  pos |= inb(CRTPORT+1);
+  if(crtpos < 0){
+    outb(CRTPORT, 14);
+    crtpos = inb(CRTPORT+1) << 8;
+    outb(CRTPORT, 15);
+    crtpos |= inb(CRTPORT+1);
+  }
+  pos = crtpos;
 
   if(c == '\n')
     pos += 80 - pos%80;
@@ -144,11 +190,22 @@ cgaputc(int c)
     memset(crt+pos, 0, sizeof(crt[0])*(24*80 - pos));
   }
   
+  crtpos = pos;
+  crtmoved = 1;
+  crt[pos] = ' ' | 0x0700;
+}
+
+// Move the hardware cursor to where cgaputc() left off.
+static void
+cgacursor(void)
+{
+  if(!crtmoved)
+    return;
+  crtmoved = 0;
   outb(CRTPORT, 14);
-  outb(CRTPORT+1, pos>>8);
+  outb(CRTPORT+1, crtpos>>8);
   outb(CRTPORT, 15);
-  outb(CRTPORT+1, pos);
-  crt[pos] = ' ' | 0x0700;
+  outb(CRTPORT+1, crtpos);
 }
 
 void
@@ -174,6 +231,7 @@ struct {
   uint r;  // Read index
   uint w;  // Write index
   uint e;  // Edit index
+  struct pollq poll;
 } input;
 
 #define C(x)  ((x)-'@')  // Control-x
@@ -210,11 +268,13 @@ consoleintr(int (*getc)(void))
         if(c == '\n' || c == C('D') || input.e == input.r+INPUT_BUF){
           input.w = input.e;
           wakeup(&input.r);
+          pollqwake(&input.poll);
         }
       }
       break;
     }
   }
+  cgacursor();
   release(&input.lock);
 }
 
@@ -256,6 +316,21 @@ consoleread(struct inode *ip, char *dst, int n)
   return target - n;
 }
 
+// Input is ready once a line is complete; output always is.
+int
+consolepoll(struct inode *ip, struct pollent *e)
+{
+  int r;
+
+  acquire(&input.lock);
+  pollqadd(&input.poll, e);
+  r = POLLOUT;
+  if(input.r != input.w)
+    r |= POLLIN;
+  release(&input.lock);
+  return r;
+}
+
 int
 consolewrite(struct inode *ip, char *buf, int n)
 {
@@ -265,6 +340,7 @@ consolewrite(struct inode *ip, char *buf, int n)
   acquire(&cons.lock);
   for(i = 0; i < n; i++)
     consputc(buf[i] & 0xff);
+  cgacursor();
   release(&cons.lock);
   ilock(ip);
 
@@ -276,9 +352,11 @@ consoleinit(void)
 {
   initlock(&cons.lock, "console");
   initlock(&input.lock, "input");
+  pollqinit(&input.poll, &input.lock);
 
   devsw[CONSOLE].write = consolewrite;
   devsw[CONSOLE].read = consoleread;
+  devsw[CONSOLE].poll = consolepoll;
   cons.locking = 1;
 
   picenable(IRQ_KBD);
@@ -0,0 +1,71 @@
+// Per-cpu record rings for the profiler and the event trace.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "proc.h"
+#include "cpuring.h"
+
+// Return the slot for this cpu's next record, or 0 if r is
+// not recording.  Called with interrupts off.
+void*
+cpuringput(struct cpuring *r)
+{
+  int c;
+
+  if(!r->on)
+    return 0;
+  c = cpu - cpus;
+  return r->buf + (c*r->nrec + r->n[c]++ % r->nrec) * r->size;
+}
+
+// Start, stop or reset recording.
+// CR_STOP returns the number of records written,
+// including any that were overwritten.
+int
+cpuringctl(struct cpuring *r, int cmd)
+{
+  int c, n;
+
+  switch(cmd){
+  case CR_START:
+    r->on = 1;
+    return 0;
+  case CR_STOP:
+    r->on = 0;
+    n = 0;
+    for(c = 0; c < ncpu; c++)
+      n += r->n[c];
+    return n;
+  case CR_RESET:
+    if(r->on)
+      return -1;
+    for(c = 0; c < ncpu; c++)
+      r->n[c] = 0;
+    return 0;
+  }
+  return -1;
+}
+
+// Copy up to max retained records, oldest first per cpu,
+// into dst.  Returns the number copied.
+int
+cpuringread(struct cpuring *r, void *dst, int max)
+{
+  int c, i, n, cnt;
+  uint first;
+  char *d;
+
+  d = dst;
+  n = 0;
+  for(c = 0; c < ncpu && n < max; c++){
+    cnt = r->n[c] < r->nrec ? r->n[c] : r->nrec;
+    first = r->n[c] - cnt;
+    for(i = 0; i < cnt && n < max; i++, n++){
+      memmove(d, r->buf + (c*r->nrec + (first + i) % r->nrec) * r->size, r->size);
+      d += r->size;
+    }
+  }
+  return n;
+}
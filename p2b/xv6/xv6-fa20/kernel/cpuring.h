@@ -0,0 +1,21 @@
+#ifndef _CPURING_H_
+#define _CPURING_H_
+
+// Per-cpu rings of fixed-size records, shared by the profiler
+// and the event trace.  Each cpu appends only to its own ring
+// with interrupts off, so appending takes no lock.  Once a ring
+// fills, the oldest records are overwritten.
+struct cpuring {
+  char *buf;        // NCPU rings of nrec records each
+  uint size;        // bytes per record
+  uint nrec;        // records kept per cpu
+  uint n[NCPU];     // records ever written; next slot is n % nrec
+  volatile int on;  // recording?
+};
+
+// cpuringctl() commands; PROF_* and TRACE_* have the same values.
+#define CR_START  1   // start recording
+#define CR_STOP   2   // stop recording; returns records written
+#define CR_RESET  3   // discard all records
+
+#endif // _CPURING_H_
@@ -1,29 +1,52 @@
 #ifndef _DEFS_H_
 #define _DEFS_H_
 
+struct blkdev;
 struct buf;
 struct context;
 struct file;
 struct inode;
 struct pipe;
+struct pollent;
+struct pollfd;
+struct pollq;
 struct proc;
+struct shm;
 struct spinlock;
 struct stat;
+struct iovec;
+struct kcache;
+struct trapframe;
 // P2B;
+struct cpuring;
+struct profsample;
+struct traceev;
 struct pstat;
+struct sysstat;
 
 // bio.c
 void            binit(void);
 struct buf*     bread(uint, uint);
 void            brelse(struct buf*);
+void            bdirect(uint, uint, void*, int);
 void            bwrite(struct buf*);
+void            blkdone(struct buf*);
+int             blkpresent(uint);
+uint            blksize(uint);
+void            blkregister(uint, struct blkdev*);
 
 // console.c
 void            consoleinit(void);
 void            cprintf(char*, ...);
+void            consputs(char*, int);
 void            consoleintr(int(*)(void));
 void            panic(char*) __attribute__((noreturn));
 
+// cpuring.c
+void*           cpuringput(struct cpuring*);
+int             cpuringctl(struct cpuring*, int);
+int             cpuringread(struct cpuring*, void*, int);
+
 // exec.c
 int             exec(char*, char**);
 
@@ -35,14 +58,26 @@ void            fileinit(void);
 int             fileread(struct file*, char*, int n);
 int             filestat(struct file*, struct stat*);
 int             filewrite(struct file*, char*, int n);
+int             fileiov(struct file*, struct iovec*, int, int, int);
+int             fileadvise(struct file*, uint, uint, int);
+int             filepoll(struct file*, struct pollent*);
+int             fdalloc(struct file*);
+void            fdclear(int);
+int             fdcopy(struct proc*);
+void            fdcloseall(struct proc*);
 
 // fs.c
 int             dirlink(struct inode*, char*, uint);
 struct inode*   dirlookup(struct inode*, char*, uint*);
 struct inode*   ialloc(uint, short);
 struct inode*   idup(struct inode*);
+int             mount(struct inode*, uint);
+void            idrop(struct inode*, uint, uint);
+char*           ipage(struct inode*, uint);
 void            iinit(void);
 void            ilock(struct inode*);
+void            ipin(struct inode*, int);
+void            iprefetch(struct inode*, uint, uint);
 void            iput(struct inode*);
 void            iunlock(struct inode*);
 void            iunlockput(struct inode*);
@@ -56,8 +91,7 @@ int             writei(struct inode*, char*, uint, uint);
 
 // ide.c
 void            ideinit(void);
-void            ideintr(void);
-void            iderw(struct buf*);
+void            ideintr(int);
 
 // ioapic.c
 void            ioapicenable(int irq, int cpu);
@@ -68,10 +102,22 @@ void            ioapicinit(void);
 char*           kalloc(void);
 void            kfree(char*);
 void            kinit(void);
+void            kref(char*);
+int             krefs(char*);
+int             kdrop(char*);
+int             kfreelast(char*);
 
 // kbd.c
 void            kbdintr(void);
 
+// klog.c
+void            klogflush(int);
+void            kloginit(void);
+int             klogread(char*, int);
+void            klogstart(void);
+int             klogsync(void);
+void            klogwrite(char*, int);
+
 // lapic.c
 int             cpunum(void);
 extern volatile uint*    lapic;
@@ -80,6 +126,14 @@ void            lapicinit(int);
 void            lapicstartap(uchar, uint);
 void            microdelay(int);
 
+// mmap.c
+int             mmap(struct file*, uint, int, int, uint);
+int             munmap(uint, uint);
+int             vmafault(uint, int);
+int             vmarange(uint, uint, int);
+int             vmacopy(struct proc*);
+void            vmacloseall(struct proc*, pde_t*);
+
 // mp.c
 extern int      ismp;
 int             mpbcpu(void);
@@ -92,14 +146,38 @@ void            picinit(void);
 
 // pipe.c
 int             pipealloc(struct file**, struct file**);
+void            pipeinit(void);
 void            pipeclose(struct pipe*, int);
-int             piperead(struct pipe*, char*, int);
-int             pipewrite(struct pipe*, char*, int);
+int             pipepoll(struct pipe*, int, struct pollent*);
+int             piperead(struct pipe*, char*, int, int);
+int             pipewrite(struct pipe*, char*, int, int);
+
+// poll.c
+int             poll(struct pollfd*, int, int);
+void            pollqadd(struct pollq*, struct pollent*);
+void            pollqinit(struct pollq*, struct spinlock*);
+void            pollqwake(struct pollq*);
+
+// prof.c
+int             profctl(int);
+int             profread(struct profsample*, int);
+void            profsample(struct trapframe*);
+
+// ramdisk.c
+void            ramdiskinit(void);
 
 // proc.c
 struct proc*    copyproc(struct proc*);
 void            exit(void);
+struct proc*    findproc(int);
+int             kthread(char*, void(*)(void));
+void            pollsleep(void*);
+void            pollwake(struct proc*);
 int             fork(void);
+int             clone(uint, uint, uint, uint);
+int             join(uint);
+int             futexwait(int*, int);
+int             futexwake(int*);
 int             growproc(int);
 int             kill(int);
 void            pinit(void);
@@ -115,10 +193,26 @@ void            yield(void);
 int             setpri(int, int);
 int             getpri(int);
 int             getpinfo(struct pstat*);
+int             getsysstat(int, struct sysstat*);
+int             mappinfo(void);
+void            pstatpublish(void);
+int             ringsetup(void);
 
 // swtch.S
 void            swtch(struct context**, struct context*);
 
+// slab.c
+void*           kcachealloc(struct kcache*);
+struct kcache*  kcachecreate(char*, uint);
+void            kcachefree(struct kcache*, void*);
+
+// shm.c
+void            shminit(void);
+int             shmat(int, uint);
+int             shmdt(uint);
+void            shmdup(struct shm*);
+void            shmput(struct shm*);
+
 // spinlock.c
 void            acquire(struct spinlock*);
 void            getcallerpcs(void*, uint*);
@@ -140,14 +234,21 @@ char*           strncpy(char*, const char*, int);
 // syscall.c
 int             argint(int, int*);
 int             argptr(int, char**, int);
-int             argstr(int, char**);
+int             argrdptr(int, char**, int);
+int             checkuptr(uint, int, int);
+int             argstr(int, char*, int);
 int             fetchint(struct proc*, uint, int*);
-int             fetchstr(struct proc*, uint, char**);
+int             fetchstr(struct proc*, uint, char*, int);
 void            syscall(void);
 
 // timer.c
 void            timerinit(void);
 
+// trace.c
+void            trace(int, uint);
+int             tracectl(int);
+int             traceread(struct traceev*, int);
+
 // trap.c
 void            idtinit(void);
 extern uint     ticks;
@@ -158,6 +259,7 @@ extern struct spinlock tickslock;
 void            uartinit(void);
 void            uartintr(void);
 void            uartputc(int);
+void            uartpolled(void);
 
 // vm.c
 void            seginit(void);
@@ -174,6 +276,13 @@ pde_t*          copyuvm(pde_t*, uint);
 void            switchuvm(struct proc*);
 void            switchkvm(void);
 int             copyout(pde_t*, uint, void*, uint);
+int             mapupage(pde_t*, uint, char*, int);
+char*           uvmpage(pde_t*, uint, int*);
+char*           uvmcow(pde_t*, uint);
+int             cowfault(pde_t*, uint);
+int             uvmunshare(pde_t*, uint);
+void            vmput(pde_t*);
+int             vmshared(pde_t*);
 
 // number of elements in fixed-size array
 #define NELEM(x) (sizeof(x)/sizeof((x)[0]))
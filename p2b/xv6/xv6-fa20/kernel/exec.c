@@ -5,6 +5,28 @@
 #include "defs.h"
 #include "x86.h"
 #include "elf.h"
+#include "fs.h"
+#include "file.h"
+
+// Cache the freshly loaded image of ip, sz bytes in pgdir, so that
+// later execs can share its pages.  The pages become copy-on-write
+// here too, since this process must not change the cached copy.
+static void
+ximage(struct inode *ip, pde_t *pgdir, uint sz)
+{
+  uint va;
+
+  if(PGROUNDUP(sz) > NXPG*PGSIZE)
+    return;
+  for(va = 0; va < sz; va += PGSIZE)
+    if(uvmpage(pgdir, va, 0) == 0)
+      return;
+  for(va = 0; va < sz; va += PGSIZE){
+    ip->xpages[va/PGSIZE] = uvmcow(pgdir, va);
+    kref(ip->xpages[va/PGSIZE]);
+  }
+  ip->xsz = PGROUNDUP(sz);
+}
 
 int
 exec(char *path, char **argv)
@@ -31,19 +53,27 @@ exec(char *path, char **argv)
   if((pgdir = setupkvm()) == 0)
     goto bad;
 
-  // Load program into memory.
+  // Load program into memory, or map the copy cached by an
+  // earlier exec of the same file.
   sz = 0;
-  for(i=0, off=elf.phoff; i<elf.phnum; i++, off+=sizeof(ph)){
-    if(readi(ip, (char*)&ph, off, sizeof(ph)) != sizeof(ph))
-      goto bad;
-    if(ph.type != ELF_PROG_LOAD)
-      continue;
-    if(ph.memsz < ph.filesz)
-      goto bad;
-    if((sz = allocuvm(pgdir, sz, ph.va + ph.memsz)) == 0)
-      goto bad;
-    if(loaduvm(pgdir, (char*)ph.va, ip, ph.offset, ph.filesz) < 0)
-      goto bad;
+  if(ip->xsz){
+    for(; sz < ip->xsz; sz += PGSIZE)
+      if(mapupage(pgdir, sz, ip->xpages[sz/PGSIZE], PTE_COW) < 0)
+        goto bad;
+  } else {
+    for(i=0, off=elf.phoff; i<elf.phnum; i++, off+=sizeof(ph)){
+      if(readi(ip, (char*)&ph, off, sizeof(ph)) != sizeof(ph))
+        goto bad;
+      if(ph.type != ELF_PROG_LOAD)
+        continue;
+      if(ph.memsz < ph.filesz)
+        goto bad;
+      if((sz = allocuvm(pgdir, sz, ph.va + ph.memsz)) == 0)
+        goto bad;
+      if(loaduvm(pgdir, (char*)ph.va, ip, ph.offset, ph.filesz) < 0)
+        goto bad;
+    }
+    ximage(ip, pgdir, sz);
   }
   iunlockput(ip);
   ip = 0;
@@ -84,10 +114,15 @@ exec(char *path, char **argv)
   oldpgdir = proc->pgdir;
   proc->pgdir = pgdir;
   proc->sz = sz;
+  proc->utop = USERTOP;
+  proc->pstatva = 0;
+  proc->ring = 0;
+  proc->ringva = 0;
   proc->tf->eip = elf.entry;  // main
   proc->tf->esp = sp;
   switchuvm(proc);
-  freevm(oldpgdir);
+  vmacloseall(proc, oldpgdir);
+  vmput(oldpgdir);
 
   return 0;
 
@@ -1,20 +1,40 @@
 #include "types.h"
 #include "defs.h"
 #include "param.h"
+#include "stat.h"
 #include "fs.h"
 #include "file.h"
 #include "spinlock.h"
+#include "mmu.h"
+#include "proc.h"
+#include "uio.h"
+#include "fcntl.h"
+#include "poll.h"
 
 struct devsw devsw[NDEV];
 struct {
   struct spinlock lock;
-  struct file file[NFILE];
+  struct kcache *cache;
 } ftable;
 
+// Pages read ahead of a FADV_SEQUENTIAL reader.
+#define NREADAHEAD 4
+
+// A process's fd table starts as the NOFILE slots in struct
+// proc and grows by factors of 4 up to NOFILEMAX, each larger
+// table coming from the matching cache.
+#define NFDCACHE 3
+static struct kcache *fdcache[NFDCACHE];
+
 void
 fileinit(void)
 {
+  int i;
+
   initlock(&ftable.lock, "ftable");
+  ftable.cache = kcachecreate("file", sizeof(struct file));
+  for(i = 0; i < NFDCACHE; i++)
+    fdcache[i] = kcachecreate("fdtable", sizeof(struct file*) * (NOFILE << 2*(i+1)));
 }
 
 // Allocate a file structure.
@@ -23,16 +43,11 @@ filealloc(void)
 {
   struct file *f;
 
-  acquire(&ftable.lock);
-  for(f = ftable.file; f < ftable.file + NFILE; f++){
-    if(f->ref == 0){
-      f->ref = 1;
-      release(&ftable.lock);
-      return f;
-    }
-  }
-  release(&ftable.lock);
-  return 0;
+  if((f = kcachealloc(ftable.cache)) == 0)
+    return 0;
+  memset(f, 0, sizeof(*f));
+  f->ref = 1;
+  return f;
 }
 
 // Increment ref count for file f.
@@ -61,9 +76,8 @@ fileclose(struct file *f)
     return;
   }
   ff = *f;
-  f->ref = 0;
-  f->type = FD_NONE;
   release(&ftable.lock);
+  kcachefree(ftable.cache, f);
   
   if(ff.type == FD_PIPE)
     pipeclose(ff.pipe, ff.writable);
@@ -93,17 +107,80 @@ fileread(struct file *f, char *addr, int n)
   if(f->readable == 0)
     return -1;
   if(f->type == FD_PIPE)
-    return piperead(f->pipe, addr, n);
+    return piperead(f->pipe, addr, n, f->flags & O_NONBLOCK);
   if(f->type == FD_INODE){
+    // Devices cannot be told not to block; ask first.
+    if((f->flags & O_NONBLOCK) && !(filepoll(f, 0) & POLLIN))
+      return -1;
     ilock(f->ip);
     if((r = readi(f->ip, addr, f->off, n)) > 0)
       f->off += r;
+    if(f->advice == FADV_SEQUENTIAL){
+      // Drop what has been read and fetch what comes next.
+      idrop(f->ip, 0, f->off);
+      iprefetch(f->ip, f->off, NREADAHEAD*PGSIZE);
+    }
     iunlock(f->ip);
     return r;
   }
   panic("fileread");
 }
 
+// Return f's poll() events, queueing e (if not 0) to be woken
+// when they may have changed.  Regular files are always ready.
+int
+filepoll(struct file *f, struct pollent *e)
+{
+  struct inode *ip;
+  int r;
+
+  if(f->type == FD_PIPE)
+    return pipepoll(f->pipe, f->writable, e);
+  ip = f->ip;
+  r = POLLIN|POLLOUT;
+  if(ip->type == T_DEV && ip->major >= 0 && ip->major < NDEV && devsw[ip->major].poll)
+    r = devsw[ip->major].poll(ip, e);
+  if(!f->readable)
+    r &= ~POLLIN;
+  if(!f->writable)
+    r &= ~POLLOUT;
+  return r;
+}
+
+// Record or act on advice about how f's data will be read,
+// for the len bytes at off (to the end of the file if len is 0).
+int
+fileadvise(struct file *f, uint off, uint len, int advice)
+{
+  struct inode *ip;
+
+  if(f->type != FD_INODE || f->ip->type != T_FILE)
+    return -1;
+  ip = f->ip;
+  if(len == 0 || off + len < off)
+    len = -off;
+  switch(advice){
+  case FADV_NORMAL:
+  case FADV_RANDOM:
+  case FADV_SEQUENTIAL:
+    f->advice = advice;
+    return 0;
+  case FADV_WILLNEED:
+    ilock(ip);
+    iprefetch(ip, off, len);
+    iunlock(ip);
+    ipin(ip, 1);
+    return 0;
+  case FADV_DONTNEED:
+    ipin(ip, 0);
+    ilock(ip);
+    idrop(ip, off, len);
+    iunlock(ip);
+    return 0;
+  }
+  return -1;
+}
+
 // Write to file f.  Addr is kernel address.
 int
 filewrite(struct file *f, char *addr, int n)
@@ -113,7 +190,7 @@ filewrite(struct file *f, char *addr, int n)
   if(f->writable == 0)
     return -1;
   if(f->type == FD_PIPE)
-    return pipewrite(f->pipe, addr, n);
+    return pipewrite(f->pipe, addr, n, f->flags & O_NONBLOCK);
   if(f->type == FD_INODE){
     ilock(f->ip);
     if((r = writei(f->ip, addr, f->off, n)) > 0)
@@ -124,3 +201,161 @@ filewrite(struct file *f, char *addr, int n)
   panic("filewrite");
 }
 
+// Read (or write, if write is set) the cnt buffers of iov,
+// which hold kernel addresses, in order.  Start at offset off,
+// or at f->off and advance it if off is -1.  The inode stays
+// locked across all the buffers.  Stops after a short transfer.
+int
+fileiov(struct file *f, struct iovec *iov, int cnt, int off, int write)
+{
+  int i, r, n;
+  uint o;
+
+  if(write ? f->writable == 0 : f->readable == 0)
+    return -1;
+  if(f->type == FD_PIPE){
+    if(off != -1)
+      return -1;  // pipes have no offset
+    n = 0;
+    for(i = 0; i < cnt; i++){
+      if(write)
+        r = pipewrite(f->pipe, iov[i].base, iov[i].len, f->flags & O_NONBLOCK);
+      else
+        r = piperead(f->pipe, iov[i].base, iov[i].len, f->flags & O_NONBLOCK);
+      if(r < 0)
+        return n ? n : -1;
+      n += r;
+      if(r < iov[i].len)
+        break;
+    }
+    return n;
+  }
+  if(f->type == FD_INODE){
+    ilock(f->ip);
+    o = off == -1 ? f->off : off;
+    n = 0;
+    for(i = 0; i < cnt; i++){
+      if(write)
+        r = writei(f->ip, iov[i].base, o, iov[i].len);
+      else
+        r = readi(f->ip, iov[i].base, o, iov[i].len);
+      if(r < 0){
+        if(n == 0)
+          n = -1;
+        break;
+      }
+      o += r;
+      n += r;
+      if(r < iov[i].len)
+        break;
+    }
+    if(off == -1)
+      f->off = o;
+    iunlock(f->ip);
+    return n;
+  }
+  panic("fileiov");
+}
+
+// Cache holding fd tables of n entries.
+static struct kcache*
+fdtabcache(int n)
+{
+  int i;
+
+  for(i = 0; (NOFILE << 2*(i+1)) != n; i++)
+    ;
+  return fdcache[i];
+}
+
+// Grow p's fd table to at least n entries.
+static int
+fdgrow(struct proc *p, int n)
+{
+  struct file **t;
+  int size;
+
+  for(size = p->nofile; size < n; size <<= 2)
+    ;
+  if(size > NOFILEMAX)
+    return -1;
+  if((t = kcachealloc(fdtabcache(size))) == 0)
+    return -1;
+  memset(t, 0, size * sizeof(t[0]));
+  memmove(t, p->ofile, p->nofile * sizeof(t[0]));
+  if(p->ofile != p->ofile0)
+    kcachefree(fdtabcache(p->nofile), p->ofile);
+  p->ofile = t;
+  p->nofile = size;
+  return 0;
+}
+
+// Allocate the lowest free file descriptor for the given file,
+// growing the table if needed.  fdfull finds the first fdmap
+// word with a clear bit, so this costs the same however many
+// descriptors are open.
+// Takes over file reference from caller on success.
+int
+fdalloc(struct file *f)
+{
+  int w, fd;
+
+  if(proc->fdfull == ~0U)
+    return -1;
+  w = __builtin_ctz(~proc->fdfull);
+  fd = w*32 + __builtin_ctz(~proc->fdmap[w]);
+  if(fd >= proc->nofile && fdgrow(proc, fd+1) < 0)
+    return -1;
+  proc->ofile[fd] = f;
+  proc->fdmap[w] |= 1U << (fd%32);
+  if(proc->fdmap[w] == ~0U)
+    proc->fdfull |= 1U << w;
+  return fd;
+}
+
+// Release file descriptor fd.  The caller closes the file.
+void
+fdclear(int fd)
+{
+  proc->ofile[fd] = 0;
+  proc->fdmap[fd/32] &= ~(1U << (fd%32));
+  proc->fdfull &= ~(1U << (fd/32));
+}
+
+// Give np, a new child, a copy of the current process's fd table.
+int
+fdcopy(struct proc *np)
+{
+  int fd;
+
+  if(proc->nofile > np->nofile && fdgrow(np, proc->nofile) < 0)
+    return -1;
+  for(fd = 0; fd < proc->nofile; fd++)
+    if(proc->ofile[fd])
+      np->ofile[fd] = filedup(proc->ofile[fd]);
+  memmove(np->fdmap, proc->fdmap, sizeof(np->fdmap));
+  np->fdfull = proc->fdfull;
+  return 0;
+}
+
+// Close all of p's files and shrink its table back to the
+// initial slots.
+void
+fdcloseall(struct proc *p)
+{
+  int fd;
+
+  for(fd = 0; fd < p->nofile; fd++){
+    if(p->ofile[fd]){
+      fileclose(p->ofile[fd]);
+      p->ofile[fd] = 0;
+    }
+  }
+  if(p->ofile != p->ofile0){
+    kcachefree(fdtabcache(p->nofile), p->ofile);
+    p->ofile = p->ofile0;
+    p->nofile = NOFILE;
+  }
+  memset(p->fdmap, 0, sizeof(p->fdmap));
+  p->fdfull = 0;
+}
@@ -8,11 +8,34 @@ struct file {
   struct pipe *pipe;
   struct inode *ip;
   uint off;
+  int advice;  // FADV_ access pattern for reads
+  int flags;   // O_NONBLOCK
+};
+
+// A queue of processes in poll() waiting on a pipe or device.
+// Entries are added and removed holding *lk, the lock that
+// guards the object's state.
+struct pollq {
+  struct spinlock *lk;
+  struct pollent *head;
+};
+
+// One poll() caller's entry on one pollq.
+struct pollent {
+  struct proc *p;
+  struct pollq *q;
+  struct pollent *next;
 };
 
 
 // in-core file system types
 
+// Pages of a regular file's data (see ipage()).
+#define NFILEPG ((MAXFILE*BSIZE + 4095) / 4096)
+
+// Pages of a loaded program image cached for exec().
+#define NXPG 40
+
 struct inode {
   uint dev;           // Device number
   uint inum;          // Inode number
@@ -25,10 +48,16 @@ struct inode {
   short nlink;
   uint size;
   uint addrs[NDIRECT+1];
+  struct inode *next;  // hash chain in icache
+  char *pages[NFILEPG];  // cached data pages, by page number
+  struct inode *lnext, *lprev;  // icache LRU, while ref is 0
+  char *xpages[NXPG];  // loaded image, shared copy-on-write by exec
+  uint xsz;            // bytes of image in xpages, 0 if none
 };
 
 #define I_BUSY 0x1
 #define I_VALID 0x2
+#define I_PIN 0x4    // pages kept even while on the icache LRU
 
 
 // device implementations
@@ -36,6 +65,7 @@ struct inode {
 struct devsw {
   int (*read)(struct inode*, char*, int);
   int (*write)(struct inode*, char*, int);
+  int (*poll)(struct inode*, struct pollent*);  // POLLIN/POLLOUT now
 };
 
 extern struct devsw devsw[];
@@ -128,16 +128,32 @@ bfree(int dev, uint b)
 // return pointers to *unlocked* inodes.  It is the callers'
 // responsibility to lock them before using them.  A non-zero
 // ip->ref keeps these unlocked inodes in the cache.
+// In-memory inodes come from a kcache and are hashed on inum.
+// When the last reference goes, the inode and the file pages it
+// caches stay on an LRU list of up to NIUNUSED inodes, so that a
+// file opened again soon, such as a binary being exec'd, is
+// still in memory; the oldest is freed to make room.  Up to
+// NIPIN inodes pinned by ipin() are passed over and not counted.
+
+#define NIHASH   61
+#define NIUNUSED 16
+#define NIPIN    8
 
 struct {
   struct spinlock lock;
-  struct inode inode[NINODE];
+  struct kcache *cache;
+  struct inode *hash[NIHASH];
+  struct inode lru;  // unreferenced inodes; lru.next is most recent
+  int nlru;          // unpinned inodes on lru
+  int npin;
 } icache;
 
 void
 iinit(void)
 {
   initlock(&icache.lock, "icache");
+  icache.cache = kcachecreate("inode", sizeof(struct inode));
+  icache.lru.lnext = icache.lru.lprev = &icache.lru;
 }
 
 static struct inode* iget(uint dev, uint inum);
@@ -191,31 +207,34 @@ iupdate(struct inode *ip)
 static struct inode*
 iget(uint dev, uint inum)
 {
-  struct inode *ip, *empty;
+  struct inode *ip;
 
   acquire(&icache.lock);
 
   // Try for cached inode.
-  empty = 0;
-  for(ip = &icache.inode[0]; ip < &icache.inode[NINODE]; ip++){
-    if(ip->ref > 0 && ip->dev == dev && ip->inum == inum){
+  for(ip = icache.hash[inum % NIHASH]; ip; ip = ip->next){
+    if(ip->dev == dev && ip->inum == inum){
+      if(ip->ref == 0){
+        ip->lprev->lnext = ip->lnext;
+        ip->lnext->lprev = ip->lprev;
+        if(!(ip->flags & I_PIN))
+          icache.nlru--;
+      }
       ip->ref++;
       release(&icache.lock);
       return ip;
     }
-    if(empty == 0 && ip->ref == 0)    // Remember empty slot.
-      empty = ip;
   }
 
   // Allocate fresh inode.
-  if(empty == 0)
+  if((ip = kcachealloc(icache.cache)) == 0)
     panic("iget: no inodes");
-
-  ip = empty;
+  memset(ip, 0, sizeof(*ip));
   ip->dev = dev;
   ip->inum = inum;
   ip->ref = 1;
-  ip->flags = 0;
+  ip->next = icache.hash[inum % NIHASH];
+  icache.hash[inum % NIHASH] = ip;
   release(&icache.lock);
 
   return ip;
@@ -277,10 +296,42 @@ iunlock(struct inode *ip)
   release(&icache.lock);
 }
 
+// Drop ip's cached program image.  Processes running it keep
+// their references to its pages.
+static void
+ixdrop(struct inode *ip)
+{
+  uint i;
+
+  for(i = 0; i < ip->xsz/PGSIZE; i++)
+    kfree(ip->xpages[i]);
+  ip->xsz = 0;
+}
+
+// Free an unreferenced inode and its cached pages.
+// Caller holds icache.lock.
+static void
+ifree(struct inode *ip)
+{
+  struct inode **pp;
+  int i;
+
+  for(i = 0; i < NFILEPG; i++)
+    if(ip->pages[i])
+      kfree(ip->pages[i]);
+  ixdrop(ip);
+  for(pp = &icache.hash[ip->inum % NIHASH]; *pp != ip; pp = &(*pp)->next)
+    ;
+  *pp = ip->next;
+  kcachefree(icache.cache, ip);
+}
+
 // Caller holds reference to unlocked ip.  Drop reference.
 void
 iput(struct inode *ip)
 {
+  struct inode *old;
+
   acquire(&icache.lock);
   if(ip->ref == 1 && (ip->flags & I_VALID) && ip->nlink == 0){
     // inode is no longer used: truncate and free inode.
@@ -292,10 +343,46 @@ iput(struct inode *ip)
     ip->type = 0;
     iupdate(ip);
     acquire(&icache.lock);
+    if(ip->flags & I_PIN)
+      icache.npin--;
     ip->flags = 0;
     wakeup(ip);
   }
-  ip->ref--;
+  if(--ip->ref == 0){
+    if(!(ip->flags & I_VALID)){
+      ifree(ip);
+    } else {
+      ip->lnext = icache.lru.lnext;
+      ip->lprev = &icache.lru;
+      icache.lru.lnext->lprev = ip;
+      icache.lru.lnext = ip;
+      if(!(ip->flags & I_PIN) && ++icache.nlru > NIUNUSED){
+        for(old = icache.lru.lprev; old->flags & I_PIN; old = old->lprev)
+          ;
+        old->lprev->lnext = old->lnext;
+        old->lnext->lprev = old->lprev;
+        icache.nlru--;
+        ifree(old);
+      }
+    }
+  }
+  release(&icache.lock);
+}
+
+// Pin ip, so that its cached pages survive on the icache LRU,
+// or unpin it.  Pinning does nothing once NIPIN inodes are
+// pinned.  Caller holds a reference to ip.
+void
+ipin(struct inode *ip, int pin)
+{
+  acquire(&icache.lock);
+  if(pin && !(ip->flags & I_PIN) && icache.npin < NIPIN){
+    ip->flags |= I_PIN;
+    icache.npin++;
+  } else if(!pin && (ip->flags & I_PIN)){
+    ip->flags &= ~I_PIN;
+    icache.npin--;
+  }
   release(&icache.lock);
 }
 
@@ -396,6 +483,7 @@ readi(struct inode *ip, char *dst, uint off, uint n)
 {
   uint tot, m;
   struct buf *bp;
+  char *pg;
 
   if(ip->type == T_DEV){
     if(ip->major < 0 || ip->major >= NDEV || !devsw[ip->major].read)
@@ -408,6 +496,16 @@ readi(struct inode *ip, char *dst, uint off, uint n)
   if(off + n > ip->size)
     n = ip->size - off;
 
+  if(ip->type == T_FILE){
+    for(tot=0; tot<n; tot+=m, off+=m, dst+=m){
+      if((pg = ipage(ip, off/PGSIZE)) == 0)
+        return tot ? tot : -1;
+      m = min(n - tot, PGSIZE - off%PGSIZE);
+      memmove(dst, pg + off%PGSIZE, m);
+    }
+    return n;
+  }
+
   for(tot=0; tot<n; tot+=m, off+=m, dst+=m){
     bp = bread(ip->dev, bmap(ip, off/BSIZE));
     m = min(n - tot, BSIZE - off%BSIZE);
@@ -417,12 +515,77 @@ readi(struct inode *ip, char *dst, uint off, uint n)
   return n;
 }
 
+// Return the cached page holding bytes [pgno*PGSIZE, (pgno+1)*PGSIZE)
+// of regular file ip, reading it in on first use.  Bytes past the
+// end of the file read as zeros.  The page stays cached until ip
+// leaves the inode cache.  File contents are read and written only
+// through these pages, straight to and from the disk, leaving the
+// buffer cache to metadata.  Caller must hold ip's lock.
+char*
+ipage(struct inode *ip, uint pgno)
+{
+  char *mem;
+  uint off, bn;
+
+  if(pgno >= NFILEPG)
+    return 0;
+  if(ip->pages[pgno])
+    return ip->pages[pgno];
+  if((mem = kalloc()) == 0)
+    return 0;
+  memset(mem, 0, PGSIZE);
+  for(off = 0; off < PGSIZE && pgno*PGSIZE + off < ip->size; off += BSIZE){
+    bn = (pgno*PGSIZE + off) / BSIZE;
+    bdirect(ip->dev, bmap(ip, bn), mem + off, 0);
+  }
+  // The last block may hold stale bytes past the end of file.
+  if(pgno*PGSIZE + off > ip->size)
+    memset(mem + (ip->size - pgno*PGSIZE), 0, pgno*PGSIZE + off - ip->size);
+  ip->pages[pgno] = mem;
+  return mem;
+}
+
+// Read the pages of regular file ip covering [off, off+len)
+// into its page cache ahead of use.  Caller must hold ip's lock.
+void
+iprefetch(struct inode *ip, uint off, uint len)
+{
+  uint pg;
+
+  if(ip->type != T_FILE || off >= ip->size)
+    return;
+  if(len > ip->size - off)
+    len = ip->size - off;
+  for(pg = off/PGSIZE; pg*PGSIZE < off + len; pg++)
+    if(ipage(ip, pg) == 0)
+      break;
+}
+
+// Drop ip's cached pages that lie wholly inside [off, off+len),
+// except those some process has mapped, which must stay the
+// file's single copy.  Pinned inodes keep all their pages.
+// Caller must hold ip's lock.
+void
+idrop(struct inode *ip, uint off, uint len)
+{
+  uint pg;
+
+  if(ip->type != T_FILE || (ip->flags & I_PIN) || off >= MAXFILE*BSIZE)
+    return;
+  if(len > MAXFILE*BSIZE - off)
+    len = MAXFILE*BSIZE - off;
+  for(pg = PGROUNDUP(off)/PGSIZE; (pg+1)*PGSIZE <= off + len && pg < NFILEPG; pg++)
+    if(ip->pages[pg] && kfreelast(ip->pages[pg]))
+      ip->pages[pg] = 0;
+}
+
 // Write data to inode.
 int
 writei(struct inode *ip, char *src, uint off, uint n)
 {
   uint tot, m;
   struct buf *bp;
+  char *pg;
 
   if(ip->type == T_DEV){
     if(ip->major < 0 || ip->major >= NDEV || !devsw[ip->major].write)
@@ -434,10 +597,22 @@ writei(struct inode *ip, char *src, uint off, uint n)
     return -1;
   if(off + n > MAXFILE*BSIZE)
     n = MAXFILE*BSIZE - off;
+  if(ip->xsz)
+    ixdrop(ip);  // the program has changed
 
   for(tot=0; tot<n; tot+=m, off+=m, src+=m){
-    bp = bread(ip->dev, bmap(ip, off/BSIZE));
     m = min(n - tot, BSIZE - off%BSIZE);
+    if(ip->type == T_FILE){
+      // Update the cached page, then write the whole block through.
+      if((pg = ipage(ip, off/PGSIZE)) == 0){
+        n = tot;
+        break;
+      }
+      memmove(pg + off%PGSIZE, src, m);
+      bdirect(ip->dev, bmap(ip, off/BSIZE), pg + off%PGSIZE - off%BSIZE, 1);
+      continue;
+    }
+    bp = bread(ip->dev, bmap(ip, off/BSIZE));
     memmove(bp->data + off%BSIZE, src, m);
     bwrite(bp);
     brelse(bp);
@@ -561,6 +736,79 @@ skipelem(char *path, char *name)
   return path;
 }
 
+// Mounts.  A directory on one file system can be covered by
+// the root of another; path lookup crosses between them.
+// Entries are set once, under icache.lock, and never removed.
+
+static struct {
+  struct inode *ip;  // covered directory
+  uint dev;          // file system on top of it
+} mounts[NMOUNT];
+
+// Mount the file system on dev over directory ip, which the
+// caller has locked.  The mount keeps the caller's reference.
+int
+mount(struct inode *ip, uint dev)
+{
+  struct superblock sb;
+  int i, free;
+
+  if(ip->type != T_DIR || (ip->dev == ROOTDEV && ip->inum == ROOTINO) ||
+     !blkpresent(dev) || dev == ROOTDEV)
+    return -1;
+  // Only take dev for a file system if its superblock describes
+  // the layout mkfs makes and fits on the device.
+  readsb(dev, &sb);
+  if(sb.size == 0 || sb.ninodes == 0 || sb.nblocks >= sb.size ||
+     (uint64)(sb.ninodes/IPB) + 3 + sb.size/BPB + 1 + sb.nblocks != sb.size ||
+     (blksize(dev) && sb.size > blksize(dev)))
+    return -1;
+  acquire(&icache.lock);
+  free = -1;
+  for(i = 0; i < NMOUNT; i++){
+    if(mounts[i].ip == 0){
+      if(free < 0)
+        free = i;
+    } else if(mounts[i].ip == ip || mounts[i].dev == dev){
+      free = -1;
+      break;
+    }
+  }
+  if(free >= 0){
+    mounts[free].ip = ip;
+    mounts[free].dev = dev;
+  }
+  release(&icache.lock);
+  return free >= 0 ? 0 : -1;
+}
+
+// If ip is covered by a mount, swap it for the mounted root.
+// With up set, go the other way: from a mounted root to the
+// directory it covers, where ".." leads out of the mount.
+static struct inode*
+mountcross(struct inode *ip, int up)
+{
+  struct inode *nip;
+  int i;
+
+  nip = 0;
+  acquire(&icache.lock);
+  for(i = 0; i < NMOUNT; i++){
+    if(mounts[i].ip == 0)
+      continue;
+    if(up ? (ip->dev == mounts[i].dev && ip->inum == ROOTINO) : ip == mounts[i].ip){
+      nip = mounts[i].ip;
+      break;
+    }
+  }
+  release(&icache.lock);
+  if(nip == 0)
+    return ip;
+  nip = up ? idup(nip) : iget(mounts[i].dev, ROOTINO);
+  iput(ip);
+  return nip;
+}
+
 // Look up and return the inode for a path name.
 // If parent != 0, return the inode for the parent and copy the final
 // path element into name, which must have room for DIRSIZ bytes.
@@ -575,6 +823,8 @@ namex(char *path, int nameiparent, char *name)
     ip = idup(proc->cwd);
 
   while((path = skipelem(path, name)) != 0){
+    if(namecmp(name, "..") == 0)
+      ip = mountcross(ip, 1);
     ilock(ip);
     if(ip->type != T_DIR){
       iunlockput(ip);
@@ -590,7 +840,7 @@ namex(char *path, int nameiparent, char *name)
       return 0;
     }
     iunlockput(ip);
-    ip = next;
+    ip = mountcross(next, 0);
   }
   if(nameiparent){
     iput(ip);
@@ -1,4 +1,10 @@
 // Simple PIO-based (non-DMA) IDE driver code.
+//
+// Handles both the primary and secondary channel, each with a
+// master and a slave drive: device numbers 0-3 are primary
+// master, primary slave, secondary master and secondary slave.
+// Each channel has its own queue and lock, so the two channels
+// transfer at the same time.
 
 #include "types.h"
 #include "defs.h"
@@ -9,146 +15,197 @@
 #include "traps.h"
 #include "spinlock.h"
 #include "buf.h"
+#include "blkdev.h"
+#include "trace.h"
 
 #define IDE_BSY       0x80
 #define IDE_DRDY      0x40
 #define IDE_DF        0x20
+#define IDE_DRQ       0x08
 #define IDE_ERR       0x01
 
 #define IDE_CMD_READ  0x20
 #define IDE_CMD_WRITE 0x30
+#define IDE_CMD_IDENT 0xec
 
-// idequeue points to the buf now being read/written to the disk.
-// idequeue->qnext points to the next buf to be processed.
-// You must hold idelock while manipulating queue.
+// queue points to the buf now being read/written to the disk.
+// queue->qnext points to the next buf to be processed.
+// You must hold lock while manipulating queue.
+struct idechan {
+  ushort base;  // command block registers
+  ushort ctl;   // device control register
+  int irq;
+  struct spinlock lock;
+  struct buf *queue;
+};
 
-static struct spinlock idelock;
-static struct buf *idequeue;
+static struct idechan chans[2] = {
+  { 0x1f0, 0x3f6, IRQ_IDE },
+  { 0x170, 0x376, IRQ_IDE2 },
+};
 
-static int havedisk1;
-static void idestart(struct buf*);
+static struct blkdev disks[4];
+
+static void idestart(struct idechan*, struct buf*);
 
 // Wait for IDE disk to become ready.
 static int
-idewait(int checkerr)
+idewait(struct idechan *c, int checkerr)
 {
   int r;
 
-  while(((r = inb(0x1f7)) & (IDE_BSY|IDE_DRDY)) != IDE_DRDY) 
+  while(((r = inb(c->base+7)) & (IDE_BSY|IDE_DRDY)) != IDE_DRDY) 
     ;
   if(checkerr && (r & (IDE_DF|IDE_ERR)) != 0)
     return -1;
   return 0;
 }
 
-void
-ideinit(void)
+// Check if a disk is present as drive on c.  A channel with
+// nothing attached reads as all ones, and drives that are not
+// disks, such as CD-ROMs, do not report ready.
+static int
+ideprobe(struct idechan *c, int drive)
 {
-  int i;
+  int i, r;
 
-  initlock(&idelock, "ide");
-  picenable(IRQ_IDE);
-  ioapicenable(IRQ_IDE, ncpu - 1);
-  idewait(0);
-  
-  // Check if disk 1 is present
-  outb(0x1f6, 0xe0 | (1<<4));
+  outb(c->base+6, 0xe0 | (drive<<4));
   for(i=0; i<1000; i++){
-    if(inb(0x1f7) != 0){
-      havedisk1 = 1;
+    r = inb(c->base+7);
+    if(r != 0xff && (r & IDE_DRDY))
+      return 1;
+  }
+  return 0;
+}
+
+// Return the number of sectors on drive, from the words the
+// drive sends back for IDENTIFY DEVICE, or 0 if it sends none.
+static uint
+idesize(struct idechan *c, int drive)
+{
+  uint id[128];
+  int i, r;
+
+  outb(c->base+6, 0xe0 | (drive<<4));
+  outb(c->base+7, IDE_CMD_IDENT);
+  for(i=0; i<100000; i++){
+    r = inb(c->base+7);
+    if(r & (IDE_DF|IDE_ERR))
+      return 0;
+    if((r & (IDE_BSY|IDE_DRQ)) == IDE_DRQ)
       break;
-    }
   }
+  if(i == 100000)
+    return 0;
+  insl(c->base, id, sizeof(id)/4);
+  return id[30];  // words 60-61: sectors addressable by LBA28
+}
+
+// Start or queue b.  Caller holds the channel lock.
+static void
+idesubmit(struct blkdev *d, struct buf *b)
+{
+  struct idechan *c;
+  struct buf **pp;
+
+  c = d->priv;
+  // Append b to queue.
+  b->qnext = 0;
+  for(pp=&c->queue; *pp; pp=&(*pp)->qnext)
+    ;
+  *pp = b;
+  trace(TR_IOSTART, b->sector | (b->flags & B_DIRTY ? TR_WRITE : 0));
   
-  // Switch back to disk 0.
-  outb(0x1f6, 0xe0 | (0<<4));
+  // Start disk if necessary.
+  if(c->queue == b)
+    idestart(c, b);
+}
+
+void
+ideinit(void)
+{
+  struct idechan *c;
+  int n, drive, any;
+
+  for(n = 0; n < 2; n++){
+    c = &chans[n];
+    initlock(&c->lock, "ide");
+    if(n == 0)
+      idewait(c, 0);
+    else if(inb(c->base+7) == 0xff)
+      continue;  // no channel
+    any = 0;
+    for(drive = 0; drive < 2; drive++){
+      // The boot disk is always there.
+      if(!(n == 0 && drive == 0) && !ideprobe(c, drive))
+        continue;
+      disks[2*n + drive].lock = &c->lock;
+      disks[2*n + drive].submit = idesubmit;
+      disks[2*n + drive].priv = c;
+      disks[2*n + drive].unit = drive;
+      disks[2*n + drive].size = idesize(c, drive);
+      blkregister(2*n + drive, &disks[2*n + drive]);
+      any = 1;
+    }
+    // Switch back to drive 0.
+    outb(c->base+6, 0xe0 | (0<<4));
+    if(!any)
+      continue;
+    picenable(c->irq);
+    ioapicenable(c->irq, ncpu - 1);
+  }
 }
 
-// Start the request for b.  Caller must hold idelock.
+// Start the request for b.  Caller must hold the channel lock.
 static void
-idestart(struct buf *b)
+idestart(struct idechan *c, struct buf *b)
 {
   if(b == 0)
     panic("idestart");
 
-  idewait(0);
-  outb(0x3f6, 0);  // generate interrupt
-  outb(0x1f2, 1);  // number of sectors
-  outb(0x1f3, b->sector & 0xff);
-  outb(0x1f4, (b->sector >> 8) & 0xff);
-  outb(0x1f5, (b->sector >> 16) & 0xff);
-  outb(0x1f6, 0xe0 | ((b->dev&1)<<4) | ((b->sector>>24)&0x0f));
+  idewait(c, 0);
+  outb(c->ctl, 0);  // generate interrupt
+  outb(c->base+2, 1);  // number of sectors
+  outb(c->base+3, b->sector & 0xff);
+  outb(c->base+4, (b->sector >> 8) & 0xff);
+  outb(c->base+5, (b->sector >> 16) & 0xff);
+  outb(c->base+6, 0xe0 | ((b->dev&1)<<4) | ((b->sector>>24)&0x0f));
   if(b->flags & B_DIRTY){
-    outb(0x1f7, IDE_CMD_WRITE);
-    outsl(0x1f0, b->data, 512/4);
+    outb(c->base+7, IDE_CMD_WRITE);
+    outsl(c->base, b->data, 512/4);
   } else {
-    outb(0x1f7, IDE_CMD_READ);
+    outb(c->base+7, IDE_CMD_READ);
   }
 }
 
-// Interrupt handler.
+// Interrupt handler for channel n.
 void
-ideintr(void)
+ideintr(int n)
 {
+  struct idechan *c;
   struct buf *b;
 
   // Take first buffer off queue.
-  acquire(&idelock);
-  if((b = idequeue) == 0){
-    release(&idelock);
+  c = &chans[n];
+  acquire(&c->lock);
+  if((b = c->queue) == 0){
+    release(&c->lock);
     // cprintf("spurious IDE interrupt\n");
     return;
   }
-  idequeue = b->qnext;
+  c->queue = b->qnext;
+  trace(TR_IODONE, b->sector | (b->flags & B_DIRTY ? TR_WRITE : 0));
 
   // Read data if needed.
-  if(!(b->flags & B_DIRTY) && idewait(1) >= 0)
-    insl(0x1f0, b->data, 512/4);
+  if(!(b->flags & B_DIRTY) && idewait(c, 1) >= 0)
+    insl(c->base, b->data, 512/4);
   
   // Wake process waiting for this buf.
-  b->flags |= B_VALID;
-  b->flags &= ~B_DIRTY;
-  wakeup(b);
+  blkdone(b);
   
   // Start disk on next buf in queue.
-  if(idequeue != 0)
-    idestart(idequeue);
-
-  release(&idelock);
-}
-
-// Sync buf with disk. 
-// If B_DIRTY is set, write buf to disk, clear B_DIRTY, set B_VALID.
-// Else if B_VALID is not set, read buf from disk, set B_VALID.
-void
-iderw(struct buf *b)
-{
-  struct buf **pp;
-
-  if(!(b->flags & B_BUSY))
-    panic("iderw: buf not busy");
-  if((b->flags & (B_VALID|B_DIRTY)) == B_VALID)
-    panic("iderw: nothing to do");
-  if(b->dev != 0 && !havedisk1)
-    panic("iderw: ide disk 1 not present");
-
-  acquire(&idelock);
-
-  // Append b to idequeue.
-  b->qnext = 0;
-  for(pp=&idequeue; *pp; pp=&(*pp)->qnext)
-    ;
-  *pp = b;
-  
-  // Start disk if necessary.
-  if(idequeue == b)
-    idestart(b);
-  
-  // Wait for request to finish.
-  // Assuming will not sleep too long: ignore proc->killed.
-  while((b->flags & (B_VALID|B_DIRTY)) != B_VALID){
-    sleep(b, &idelock);
-  }
+  if(c->queue != 0)
+    idestart(c, c->queue);
 
-  release(&idelock);
+  release(&c->lock);
 }
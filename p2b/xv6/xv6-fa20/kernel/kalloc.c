@@ -15,6 +15,7 @@ struct run {
 struct {
   struct spinlock lock;
   struct run *freelist;
+  uint ref[PHYSTOP/PGSIZE];  // references to each physical page
 } kmem;
 
 extern char end[]; // first address after kernel loaded from ELF file
@@ -27,14 +28,86 @@ kinit(void)
 
   initlock(&kmem.lock, "kmem");
   p = (char*)PGROUNDUP((uint)end);
-  for(; p + PGSIZE <= (char*)PHYSTOP; p += PGSIZE)
+  for(; p + PGSIZE <= (char*)PHYSTOP; p += PGSIZE){
+    kmem.ref[(uint)p/PGSIZE] = 1;
     kfree(p);
+  }
 }
 
-// Free the page of physical memory pointed at by v,
-// which normally should have been returned by a
+// Take another reference to page v, which must have come
+// from kalloc().  Used when one physical page is mapped into
+// more than one address space; each mapping drops its
+// reference with kfree().  Each reference is a mapping or a
+// holder of the page, so a uint count cannot overflow.
+void
+kref(char *v)
+{
+  if((uint)v % PGSIZE || v < end || (uint)v >= PHYSTOP)
+    panic("kref");
+
+  acquire(&kmem.lock);
+  if(kmem.ref[(uint)v/PGSIZE] < 1)
+    panic("kref count");
+  kmem.ref[(uint)v/PGSIZE]++;
+  release(&kmem.lock);
+}
+
+// Return the number of references to page v.
+int
+krefs(char *v)
+{
+  int r;
+
+  if((uint)v % PGSIZE || v < end || (uint)v >= PHYSTOP)
+    panic("krefs");
+
+  acquire(&kmem.lock);
+  r = kmem.ref[(uint)v/PGSIZE];
+  release(&kmem.lock);
+  return r;
+}
+
+// Drop a reference to page v unless it is the last one.
+// Returns 1 if it dropped one, 0 if v has a single reference,
+// which the caller should then free in full.
+int
+kdrop(char *v)
+{
+  int r;
+
+  if((uint)v % PGSIZE || v < end || (uint)v >= PHYSTOP)
+    panic("kdrop");
+
+  acquire(&kmem.lock);
+  if((r = kmem.ref[(uint)v/PGSIZE] > 1))
+    kmem.ref[(uint)v/PGSIZE]--;
+  release(&kmem.lock);
+  return r;
+}
+
+// Free page v if the caller holds its only reference.
+// Returns 1 if it did, 0 if v is shared and was left alone.
+int
+kfreelast(char *v)
+{
+  int r;
+
+  if((uint)v % PGSIZE || v < end || (uint)v >= PHYSTOP)
+    panic("kfreelast");
+
+  acquire(&kmem.lock);
+  r = kmem.ref[(uint)v/PGSIZE] == 1;
+  release(&kmem.lock);
+  if(r)
+    kfree(v);
+  return r;
+}
+
+// Drop a reference to the page of physical memory pointed
+// at by v, which normally should have been returned by a
 // call to kalloc().  (The exception is when
 // initializing the allocator; see kinit above.)
+// The page goes back on the free list with its last reference.
 void
 kfree(char *v)
 {
@@ -43,6 +116,15 @@ kfree(char *v)
   if((uint)v % PGSIZE || v < end || (uint)v >= PHYSTOP) 
     panic("kfree");
 
+  acquire(&kmem.lock);
+  if(kmem.ref[(uint)v/PGSIZE] < 1)
+    panic("kfree: free page");
+  if(--kmem.ref[(uint)v/PGSIZE] > 0){
+    release(&kmem.lock);
+    return;
+  }
+  release(&kmem.lock);
+
   // Fill with junk to catch dangling refs.
   memset(v, 1, PGSIZE);
 
@@ -63,8 +145,10 @@ kalloc(void)
 
   acquire(&kmem.lock);
   r = kmem.freelist;
-  if(r)
+  if(r){
     kmem.freelist = r->next;
+    kmem.ref[(uint)r/PGSIZE] = 1;
+  }
   release(&kmem.lock);
   return (char*)r;
 }
@@ -0,0 +1,208 @@
+// Kernel log.
+//
+// cprintf() appends each message as a record to its CPU's klog
+// ring with interrupts off and no lock: a ring has one writer,
+// its own CPU.  Records carry a global sequence number, so the
+// rings can be merged back into order.  The klogd kernel thread
+// copies new records to the console once a tick; until it runs,
+// and after a panic, cprintf() copies them out itself.  Records
+// already on the console stay in the ring for dmesg() until
+// newer ones overwrite them.  If a ring fills with records not
+// yet on the console, new messages are dropped and counted.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "proc.h"
+#include "spinlock.h"
+
+struct klogrec {
+  uint seq;
+  uint len;  // bytes of text after the header
+};
+
+struct klog {
+  char buf[KLOGSIZE];
+  volatile uint w;      // end of the newest record (bytes ever written)
+  volatile uint first;  // start of the oldest record still in buf
+  volatile uint out;    // start of the first record not yet on the console
+  uint lost;            // messages dropped
+  uint lostshown;       // ... and already reported on the console
+};
+
+static struct klog klogs[NCPU];
+static uint klogseq;
+static struct spinlock flushlock;  // one drainer at a time
+static int klogdrunning;
+
+// Copy n bytes between buf, at ring offset off, and p.
+static void
+ringput(struct klog *k, uint off, void *p, uint n)
+{
+  char *s;
+
+  for(s = p; n > 0; n--)
+    k->buf[off++ % KLOGSIZE] = *s++;
+}
+
+static void
+ringget(struct klog *k, uint off, void *p, uint n)
+{
+  char *d;
+
+  for(d = p; n > 0; n--)
+    *d++ = k->buf[off++ % KLOGSIZE];
+}
+
+// Append n bytes of s to this CPU's ring as one record.
+void
+klogwrite(char *s, int n)
+{
+  struct klog *k;
+  struct klogrec r;
+  uint need;
+
+  pushcli();
+  k = &klogs[cpu->id];
+  need = sizeof(r) + n;
+  while(k->w + need - k->first > KLOGSIZE){
+    if(k->first == k->out){
+      k->lost++;
+      popcli();
+      return;
+    }
+    ringget(k, k->first, &r, sizeof(r));
+    k->first += sizeof(r) + r.len;
+  }
+  r.seq = __sync_fetch_and_add(&klogseq, 1);
+  r.len = n;
+  ringput(k, k->w, &r, sizeof(r));
+  ringput(k, k->w + sizeof(r), s, n);
+  __sync_synchronize();  // record before w
+  k->w += need;
+  popcli();
+}
+
+// Return the ring whose oldest record at or after its cursor
+// (cur[i], or out if cur is 0) comes first, or 0 if none has one.
+// Sets *rp to that record's header.
+static struct klog*
+klognext(uint *cur, struct klogrec *rp)
+{
+  struct klog *k, *best;
+  struct klogrec r;
+  uint c;
+  int i;
+
+  best = 0;
+  for(i = 0; i < NCPU; i++){
+    k = &klogs[i];
+    c = cur ? cur[i] : k->out;
+    if(c == k->w)
+      continue;
+    ringget(k, c, &r, sizeof(r));
+    if(best == 0 || (int)(r.seq - rp->seq) < 0){
+      best = k;
+      *rp = r;
+    }
+  }
+  return best;
+}
+
+// Copy records not yet on the console to it, in order.
+// locking is 0 after a panic, when locks may be held forever.
+void
+klogflush(int locking)
+{
+  struct klog *k;
+  struct klogrec r;
+  char text[128];
+  uint off, m;
+
+  if(locking)
+    acquire(&flushlock);
+  while((k = klognext(0, &r)) != 0){
+    __sync_synchronize();  // w before the record
+    for(off = 0; off < r.len; off += m){
+      m = r.len - off < sizeof(text) ? r.len - off : sizeof(text);
+      ringget(k, k->out + sizeof(r) + off, text, m);
+      consputs(text, m);
+    }
+    __sync_synchronize();  // done reading before freeing it
+    k->out += sizeof(r) + r.len;
+  }
+  for(k = klogs; k < &klogs[NCPU]; k++){
+    if(k->lost == k->lostshown)
+      continue;
+    k->lostshown = k->lost;
+    consputs("\nklog: messages dropped\n", 24);
+  }
+  if(locking)
+    release(&flushlock);
+}
+
+// Should cprintf() copy its message to the console itself?
+int
+klogsync(void)
+{
+  return !klogdrunning;
+}
+
+static void
+klogd(void)
+{
+  klogdrunning = 1;
+  for(;;){
+    klogflush(1);
+    acquire(&tickslock);
+    sleep(&ticks, &tickslock);
+    release(&tickslock);
+  }
+}
+
+void
+kloginit(void)
+{
+  initlock(&flushlock, "klog");
+}
+
+// Start the thread that writes the log out.
+void
+klogstart(void)
+{
+  if(kthread("klogd", klogd) < 0)
+    panic("klogstart");
+}
+
+// Copy up to n bytes of the log, oldest first and merged across
+// CPUs, to dst.  Records being overwritten as they are read are
+// skipped.  Returns the number of bytes copied.
+int
+klogread(char *dst, int n)
+{
+  struct klog *k;
+  struct klogrec r;
+  uint cur[NCPU];
+  int i, tot;
+
+  for(i = 0; i < NCPU; i++)
+    cur[i] = klogs[i].first;
+  tot = 0;
+  for(;;){
+    // Move cursors the writers have overwritten past.
+    for(i = 0; i < NCPU; i++)
+      if((int)(cur[i] - klogs[i].first) < 0)
+        cur[i] = klogs[i].first;
+    if((k = klognext(cur, &r)) == 0 || (int)r.len > n - tot)
+      break;
+    i = k - klogs;
+    ringget(k, cur[i] + sizeof(r), dst + tot, r.len);
+    __sync_synchronize();
+    if((int)(cur[i] - k->first) < 0)
+      continue;  // overwritten while copying
+    cur[i] += sizeof(r) + r.len;
+    tot += r.len;
+  }
+  return tot;
+}
@@ -45,6 +45,7 @@ mainc(void)
   cprintf("\ncpu%d: starting xv6\n\n", cpu->id);
   picinit();       // interrupt controller
   ioapicinit();    // another interrupt controller
+  kloginit();      // kernel log
   consoleinit();   // I/O devices & their interrupts
   uartinit();      // serial port
   kvmalloc();      // initialize the kernel page table
@@ -52,8 +53,11 @@ mainc(void)
   tvinit();        // trap vectors
   binit();         // buffer cache
   fileinit();      // file table
+  pipeinit();      // pipe cache
   iinit();         // inode cache
+  shminit();       // shared memory segments
   ideinit();       // disk
+  ramdiskinit();   // RAM disk
   if(!ismp)
     timerinit();   // uniprocessor timer
   bootothers();    // start other processors
@@ -62,6 +66,7 @@ mainc(void)
   cinit();
   sti();           // enable inturrupts
   userinit();      // first user process
+  klogstart();     // kernel log writer
   scheduler();     // start running processes
 }
 
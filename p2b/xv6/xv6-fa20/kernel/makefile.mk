@@ -3,6 +3,7 @@
 KERNEL_OBJECTS := \
 	bio.o\
 	console.o\
+	cpuring.o\
 	exec.o\
 	file.o\
 	fs.o\
@@ -10,12 +11,19 @@ KERNEL_OBJECTS := \
 	ioapic.o\
 	kalloc.o\
 	kbd.o\
+	klog.o\
 	lapic.o\
 	main.o\
+	mmap.o\
 	mp.o\
 	picirq.o\
 	pipe.o\
+	poll.o\
+	prof.o\
 	proc.o\
+	ramdisk.o\
+	shm.o\
+	slab.o\
 	spinlock.o\
 	string.o\
 	swtch.o\
@@ -23,6 +31,7 @@ KERNEL_OBJECTS := \
 	sysfile.o\
 	sysproc.o\
 	timer.o\
+	trace.o\
 	trapasm.o\
 	trap.o\
 	uart.o\
@@ -59,6 +68,7 @@ KERNEL_CLEAN := \
 	kernel/bootother.out\
 	kernel/initcode.out\
 	kernel/kernel\
+	kernel/kernel.sym\
 	bootother\
 	initcode\
 	xv6.img
@@ -101,6 +111,10 @@ kernel/kernel:	\
 		kernel/multiboot.o kernel/data.o $(KERNEL_OBJECTS) \
 		-b binary initcode bootother
 
+# function symbols for the profiler, installed as /kernel.sym
+kernel/kernel.sym: kernel/kernel
+	$(OBJDUMP) -t $< | awk '/ F \.text/ { print $$1, $$NF }' | sort > $@
+
 # bootblock is optimized for space
 kernel/bootmain.o: kernel/bootmain.c
 	$(CC) $(CPPFLAGS) $(KERNEL_CPPFLAGS) $(CFLAGS) $(KERNEL_CFLAGS) \
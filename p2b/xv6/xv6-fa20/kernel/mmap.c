@@ -0,0 +1,237 @@
+// Memory-mapped files.
+//
+// mmap() reserves address space below proc->utop and records a
+// vma; nothing is mapped until the process touches a page.  The
+// fault handler then maps the inode's cached page (see ipage()),
+// directly for shared or read-only mappings and as a private copy
+// for writable private ones.  Shared pages dirtied through a
+// mapping are written back to the file when it is unmapped.
+//
+// Each thread has its own vmas and utop, so while threads share
+// the page table no mappings can be made or removed; one closed
+// at exit stays in the page table until it is freed.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "stat.h"
+#include "mmu.h"
+#include "proc.h"
+#include "fs.h"
+#include "file.h"
+#include "mman.h"
+
+// Map len bytes of f, starting at page-aligned offset off, into
+// the current process.  Returns the address of the mapping, or -1.
+int
+mmap(struct file *f, uint len, int prot, int flags, uint off)
+{
+  struct vma *v, *fv;
+  uint va;
+
+  if(f->type != FD_INODE || f->ip->type != T_FILE || vmshared(proc->pgdir))
+    return -1;
+  if(len == 0 || off % PGSIZE || (flags != MAP_SHARED && flags != MAP_PRIVATE))
+    return -1;
+  if(!f->readable || ((prot & PROT_WRITE) && flags == MAP_SHARED && !f->writable))
+    return -1;
+  len = PGROUNDUP(len);
+  if(len > proc->utop || (va = proc->utop - len) < PGROUNDUP(proc->sz))
+    return -1;
+
+  fv = 0;
+  for(v = proc->vma; v < &proc->vma[NVMA]; v++)
+    if(v->end == 0){
+      fv = v;
+      break;
+    }
+  if(fv == 0)
+    return -1;
+  fv->start = va;
+  fv->end = va + len;
+  fv->f = filedup(f);
+  fv->off = off;
+  fv->prot = prot;
+  fv->flags = flags;
+  proc->utop = va;
+  return va;
+}
+
+// Write back v's dirty shared pages, unmap it from pgdir and
+// drop its file or segment.
+static void
+vmaclose(struct proc *p, pde_t *pgdir, struct vma *v)
+{
+  struct inode *ip;
+  uint va, off;
+  char *pa;
+  int dirty, unmap;
+
+  // Other threads may still be running on pgdir; freevm() will
+  // drop the pages left mapped.
+  unmap = !vmshared(pgdir);
+  if(v->shm){
+    if(unmap)
+      deallocuvm(pgdir, v->end, v->start);
+    shmput(v->shm);
+    goto out;
+  }
+  ip = v->f->ip;
+  if(v->flags == MAP_SHARED && (v->prot & PROT_WRITE)){
+    ilock(ip);
+    for(va = v->start; va < v->end; va += PGSIZE){
+      if((pa = uvmpage(pgdir, va, &dirty)) == 0 || !dirty)
+        continue;
+      off = v->off + (va - v->start);
+      if(off < ip->size)
+        writei(ip, pa, off, ip->size - off < PGSIZE ? ip->size - off : PGSIZE);
+    }
+    iunlock(ip);
+  }
+  if(unmap)
+    deallocuvm(pgdir, v->end, v->start);
+  fileclose(v->f);
+out:
+  if(v->start == p->utop)
+    p->utop = v->end;
+  memset(v, 0, sizeof(*v));
+}
+
+// Remove the mapping made by mmap() or shmat() at addr.  Only
+// whole mappings can be unmapped.
+int
+munmap(uint addr, uint len)
+{
+  struct vma *v;
+
+  if(vmshared(proc->pgdir))
+    return -1;
+  for(v = proc->vma; v < &proc->vma[NVMA]; v++){
+    if(v->end == 0 || v->start != addr)
+      continue;
+    if(PGROUNDUP(len) != v->end - v->start)
+      return -1;
+    vmaclose(proc, proc->pgdir, v);
+    switchuvm(proc);  // flush the old mappings from the TLB
+    return 0;
+  }
+  return -1;
+}
+
+// Close all of p's mappings, which are in pgdir.
+void
+vmacloseall(struct proc *p, pde_t *pgdir)
+{
+  struct vma *v;
+
+  for(v = p->vma; v < &p->vma[NVMA]; v++)
+    if(v->end)
+      vmaclose(p, pgdir, v);
+}
+
+// Handle a page fault at va in the current process.  Returns 0
+// if va is in a mapping that allows the access and its page is
+// now mapped, -1 otherwise.
+int
+vmafault(uint va, int write)
+{
+  struct vma *v;
+  struct inode *ip;
+  char *pa, *mem;
+  int r;
+
+  for(v = proc->vma; v < &proc->vma[NVMA]; v++)
+    if(v->end && va >= v->start && va < v->end)
+      break;
+  if(v == &proc->vma[NVMA] || v->shm)
+    return -1;
+  if(write && !(v->prot & PROT_WRITE))
+    return -1;
+  va = (uint)PGROUNDDOWN(va);
+  if(uvmpage(proc->pgdir, va, 0))
+    return -1;  // present: a protection fault
+
+  ip = v->f->ip;
+  ilock(ip);
+  if((pa = ipage(ip, (v->off + (va - v->start)) / PGSIZE)) == 0){
+    iunlock(ip);
+    return -1;
+  }
+  if(v->flags == MAP_SHARED || !(v->prot & PROT_WRITE)){
+    r = mapupage(proc->pgdir, va, pa, (v->prot & PROT_WRITE) ? PTE_W : 0);
+  } else {
+    if((mem = kalloc()) == 0){
+      iunlock(ip);
+      return -1;
+    }
+    memmove(mem, pa, PGSIZE);
+    r = mapupage(proc->pgdir, va, mem, PTE_W);
+    kfree(mem);  // the mapping holds the only reference
+  }
+  iunlock(ip);
+  return r;
+}
+
+// Check that the len bytes at va lie in one of the current
+// process's mappings, writable if write is set, and fault in
+// their pages so that system calls can use them directly.
+// Returns 0, or -1.
+int
+vmarange(uint va, uint len, int write)
+{
+  struct vma *v;
+  uint a;
+
+  for(v = proc->vma; v < &proc->vma[NVMA]; v++)
+    if(v->end && va >= v->start && va < v->end)
+      break;
+  if(v == &proc->vma[NVMA] || len > v->end - va)
+    return -1;
+  if(write && !(v->prot & PROT_WRITE))
+    return -1;
+  for(a = (uint)PGROUNDDOWN(va); a < va + len; a += PGSIZE)
+    if(uvmpage(proc->pgdir, a, 0) == 0 && vmafault(a, 0) < 0)
+      return -1;
+  return 0;
+}
+
+// Give np, a new child, the current process's mappings.  Pages
+// already faulted in are shared, except those of writable
+// private mappings, which are copied.
+int
+vmacopy(struct proc *np)
+{
+  struct vma *v, *nv;
+  uint va;
+  char *pa, *mem;
+  int perm;
+
+  for(v = proc->vma, nv = np->vma; v < &proc->vma[NVMA]; v++, nv++){
+    if(v->end == 0)
+      continue;
+    *nv = *v;
+    if(v->shm)
+      shmdup(v->shm);
+    else
+      filedup(v->f);
+    perm = (v->prot & PROT_WRITE) ? PTE_W : 0;
+    for(va = v->start; va < v->end; va += PGSIZE){
+      if((pa = uvmpage(proc->pgdir, va, 0)) == 0)
+        continue;
+      if(v->flags == MAP_SHARED || !perm){
+        if(mapupage(np->pgdir, va, pa, perm) < 0)
+          return -1;
+        continue;
+      }
+      if((mem = kalloc()) == 0)
+        return -1;
+      memmove(mem, pa, PGSIZE);
+      if(mapupage(np->pgdir, va, mem, perm) < 0){
+        kfree(mem);
+        return -1;
+      }
+      kfree(mem);
+    }
+  }
+  return 0;
+}
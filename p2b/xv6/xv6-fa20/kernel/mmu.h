@@ -39,6 +39,10 @@
 #define CR0_CD		0x40000000	// Cache Disable
 #define CR0_PG		0x80000000	// Paging
 
+// Control Register 4 flags
+#define CR4_PSE		0x00000010	// Page Size Extension
+#define CR4_PGE		0x00000080	// Page Global Enable
+
 // Segment Descriptor
 struct segdesc {
   uint lim_15_0 : 16;  // Low bits of segment limit
@@ -117,6 +121,7 @@ struct segdesc {
 #define NPTENTRIES	1024		// page table entries per page table
 
 #define PGSIZE		4096		// bytes mapped by a page
+#define PTSIZE		(PGSIZE*NPTENTRIES) // bytes mapped by a page directory entry
 #define PGSHIFT		12		// log2(PGSIZE)
 
 #define PTXSHIFT	12		// offset of PTX in a linear address
@@ -134,10 +139,18 @@ struct segdesc {
 #define PTE_A		0x020	// Accessed
 #define PTE_D		0x040	// Dirty
 #define PTE_PS		0x080	// Page Size
+#define PTE_G		0x100	// Global
+#define PTE_COW		0x200	// Copy-on-write (software-defined)
 #define PTE_MBZ		0x180	// Bits must be zero
 
+// Page fault error code bits
+#define FEC_PR		0x1	// Protection violation (else not present)
+#define FEC_WR		0x2	// Caused by a write
+#define FEC_U		0x4	// Fault in user mode
+
 // Address in page table or page directory entry
 #define PTE_ADDR(pte)	((uint)(pte) & ~0xFFF)
+#define PTE_FLAGS(pte)	((uint)(pte) & 0xFFF)
 
 typedef uint pte_t;
 
@@ -6,6 +6,7 @@
 #include "fs.h"
 #include "file.h"
 #include "spinlock.h"
+#include "poll.h"
 
 #define PIPESIZE 512
 
@@ -16,8 +17,17 @@ struct pipe {
   uint nwrite;    // number of bytes written
   int readopen;   // read fd is still open
   int writeopen;  // write fd is still open
+  struct pollq poll;  // poll() callers waiting on either end
 };
 
+static struct kcache *pipecache;
+
+void
+pipeinit(void)
+{
+  pipecache = kcachecreate("pipe", sizeof(struct pipe));
+}
+
 int
 pipealloc(struct file **f0, struct file **f1)
 {
@@ -27,13 +37,14 @@ pipealloc(struct file **f0, struct file **f1)
   *f0 = *f1 = 0;
   if((*f0 = filealloc()) == 0 || (*f1 = filealloc()) == 0)
     goto bad;
-  if((p = (struct pipe*)kalloc()) == 0)
+  if((p = kcachealloc(pipecache)) == 0)
     goto bad;
   p->readopen = 1;
   p->writeopen = 1;
   p->nwrite = 0;
   p->nread = 0;
   initlock(&p->lock, "pipe");
+  pollqinit(&p->poll, &p->lock);
   (*f0)->type = FD_PIPE;
   (*f0)->readable = 1;
   (*f0)->writable = 0;
@@ -46,7 +57,7 @@ pipealloc(struct file **f0, struct file **f1)
 
  bad:
   if(p)
-    kfree((char*)p);
+    kcachefree(pipecache, p);
   if(*f0)
     fileclose(*f0);
   if(*f1)
@@ -65,43 +76,53 @@ pipeclose(struct pipe *p, int writable)
     p->readopen = 0;
     wakeup(&p->nwrite);
   }
+  pollqwake(&p->poll);
   if(p->readopen == 0 && p->writeopen == 0){
     release(&p->lock);
-    kfree((char*)p);
+    kcachefree(pipecache, p);
   } else
     release(&p->lock);
 }
 
+// Write n bytes to p.  If nonblock is set, write only what fits
+// now, failing if that is nothing.
 int
-pipewrite(struct pipe *p, char *addr, int n)
+pipewrite(struct pipe *p, char *addr, int n, int nonblock)
 {
   int i;
 
   acquire(&p->lock);
   for(i = 0; i < n; i++){
     while(p->nwrite == p->nread + PIPESIZE){  //DOC: pipewrite-full
-      if(p->readopen == 0 || proc->killed){
+      if(p->readopen == 0 || proc->killed || (nonblock && i == 0)){
         release(&p->lock);
         return -1;
       }
+      if(nonblock)
+        goto out;
       wakeup(&p->nread);
+      pollqwake(&p->poll);
       sleep(&p->nwrite, &p->lock);  //DOC: pipewrite-sleep
     }
     p->data[p->nwrite++ % PIPESIZE] = addr[i];
   }
+out:
   wakeup(&p->nread);  //DOC: pipewrite-wakeup1
+  pollqwake(&p->poll);
   release(&p->lock);
-  return n;
+  return i;
 }
 
+// Read up to n bytes from p, waiting for some to arrive
+// unless nonblock is set.
 int
-piperead(struct pipe *p, char *addr, int n)
+piperead(struct pipe *p, char *addr, int n, int nonblock)
 {
   int i;
 
   acquire(&p->lock);
   while(p->nread == p->nwrite && p->writeopen){  //DOC: pipe-empty
-    if(proc->killed){
+    if(proc->killed || nonblock){
       release(&p->lock);
       return -1;
     }
@@ -113,6 +134,33 @@ piperead(struct pipe *p, char *addr, int n)
     addr[i] = p->data[p->nread++ % PIPESIZE];
   }
   wakeup(&p->nwrite);  //DOC: piperead-wakeup
+  pollqwake(&p->poll);
   release(&p->lock);
   return i;
 }
+
+// Return which of POLLIN/POLLHUP (for the read end) or
+// POLLOUT/POLLERR (for the write end) hold for p, queueing e
+// to be woken when that changes.
+int
+pipepoll(struct pipe *p, int writable, struct pollent *e)
+{
+  int r;
+
+  acquire(&p->lock);
+  pollqadd(&p->poll, e);
+  r = 0;
+  if(writable){
+    if(p->nwrite < p->nread + PIPESIZE)
+      r |= POLLOUT;
+    if(p->readopen == 0)
+      r |= POLLERR;
+  } else {
+    if(p->nread != p->nwrite)
+      r |= POLLIN;
+    if(p->writeopen == 0)
+      r |= POLLHUP;
+  }
+  release(&p->lock);
+  return r;
+}
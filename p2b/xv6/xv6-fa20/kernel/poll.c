@@ -0,0 +1,108 @@
+// poll(): wait until one of several files is ready.
+//
+// Pipes and the console keep a pollq of waiting pollers and call
+// pollqwake() whenever they wake their own readers or writers.
+// poll() puts one entry on the queue of each file it watches,
+// then sleeps until any of them wakes it (see pollwake()).
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "fs.h"
+#include "file.h"
+#include "poll.h"
+
+void
+pollqinit(struct pollq *q, struct spinlock *lk)
+{
+  q->lk = lk;
+  q->head = 0;
+}
+
+// Add the current process's entry e to q, once.
+// Caller holds q->lk.
+void
+pollqadd(struct pollq *q, struct pollent *e)
+{
+  if(e == 0 || e->q)
+    return;
+  e->p = proc;
+  e->q = q;
+  e->next = q->head;
+  q->head = e;
+}
+
+// Take e off its queue, if it is on one.
+static void
+pollqdel(struct pollent *e)
+{
+  struct pollent **pp;
+
+  if(e->q == 0)
+    return;
+  acquire(e->q->lk);
+  for(pp = &e->q->head; *pp != e; pp = &(*pp)->next)
+    ;
+  *pp = e->next;
+  release(e->q->lk);
+  e->q = 0;
+}
+
+// Wake every process polling q.  Caller holds q->lk.
+void
+pollqwake(struct pollq *q)
+{
+  struct pollent *e;
+
+  for(e = q->head; e; e = e->next)
+    pollwake(e->p);
+}
+
+// Fill in revents for the nfds entries of fds, waiting up to
+// timeout ticks (forever if negative) for one to be ready.
+// Returns the number of ready entries, 0 on timeout, or -1.
+int
+poll(struct pollfd *fds, int nfds, int timeout)
+{
+  struct pollent ents[NPOLL];
+  struct file *f;
+  uint t0;
+  int i, n;
+
+  if(nfds < 0 || nfds > NPOLL)
+    return -1;
+  memset(ents, 0, sizeof(ents));
+  acquire(&tickslock);
+  t0 = ticks;
+  release(&tickslock);
+
+  for(;;){
+    proc->pollev = 0;
+    n = 0;
+    for(i = 0; i < nfds; i++){
+      fds[i].revents = 0;
+      if(fds[i].fd < 0)
+        continue;
+      if(fds[i].fd >= proc->nofile || (f = proc->ofile[fds[i].fd]) == 0)
+        fds[i].revents = POLLNVAL;
+      else
+        fds[i].revents = filepoll(f, &ents[i]) & (fds[i].events|POLLERR|POLLHUP);
+      if(fds[i].revents)
+        n++;
+    }
+    if(n || timeout == 0 || proc->killed)
+      break;
+    if(timeout > 0){
+      if(ticks - t0 >= timeout)
+        break;
+      pollsleep(&ticks);  // also woken by the timer to check the time
+    } else
+      pollsleep(proc);
+  }
+  for(i = 0; i < nfds; i++)
+    pollqdel(&ents[i]);
+  return n == 0 && proc->killed ? -1 : n;
+}
@@ -6,6 +6,7 @@
 #include "proc.h"
 #include "spinlock.h"
 #include "circleQueue.h"
+#include "trace.h"
 
 // P2B constants
 #define PQ3_TICKS 8
@@ -14,9 +15,16 @@
 #define PQ0_TICKS 0
 #define NUM_PQ 4
 
+// Procs are allocated from a kcache as needed.  Every proc is on
+// ptable.list and hashed by pid; each also heads a list of its
+// children, linked through sibling.  All guarded by ptable.lock.
+#define NPIDHASH 64
+
 struct {
   struct spinlock lock;
-  struct proc proc[NPROC];
+  struct kcache *cache;
+  struct proc *list;
+  struct proc *pidhash[NPIDHASH];
 } ptable;
 
 // P2B - add queue arrays
@@ -24,6 +32,11 @@ static circleQueue pq[NUM_PQ];
 
 static struct proc *initproc;
 
+// Kernel-owned pstat snapshot shared read-only with any
+// process that calls mappinfo().
+static struct pstatpage *pstatpg;
+static int pstatlive;  // set once anyone maps it
+
 int nextpid = 1;
 extern void forkret(void);
 extern void trapret(void);
@@ -34,35 +47,102 @@ void
 pinit(void)
 {
   initlock(&ptable.lock, "ptable");
+  ptable.cache = kcachecreate("proc", sizeof(struct proc));
+  if((pstatpg = (struct pstatpage*)kalloc()) == 0)
+    panic("pinit: pstat page");
+  memset(pstatpg, 0, PGSIZE);
+}
+
+static int waitchild(int, uint*);
+
+// Return the process with the given pid, or 0.
+// Caller must hold ptable.lock.
+struct proc*
+findproc(int pid)
+{
+  struct proc *p;
+
+  for(p = ptable.pidhash[pid % NPIDHASH]; p; p = p->hnext)
+    if(p->pid == pid)
+      return p;
+  return 0;
+}
+
+// Free p's kernel stack and histogram pages and p itself.
+static void
+freeprocmem(struct proc *p)
+{
+  int i;
+
+  if(p->kstack)
+    kfree(p->kstack);
+  for(i = 0; i < NHISTPG; i++)
+    if(p->schist[i])
+      kfree((char*)p->schist[i]);
+  kcachefree(ptable.cache, p);
 }
 
-// Look in the process table for an UNUSED proc.
-// If found, change state to EMBRYO and initialize
-// state required to run in the kernel.
-// Otherwise return 0.
+// Unlink p from the process list, the pid hash, its parent's
+// children and its priority queue, then free it.  The caller must hold
+// ptable.lock and have freed p's user memory.
+static void
+freeproc(struct proc *p)
+{
+  struct proc **pp;
+
+  if(p->prev)
+    p->prev->next = p->next;
+  else
+    ptable.list = p->next;
+  if(p->next)
+    p->next->prev = p->prev;
+  for(pp = &ptable.pidhash[p->pid % NPIDHASH]; *pp != p; pp = &(*pp)->hnext)
+    ;
+  *pp = p->hnext;
+  if(p->parent){
+    for(pp = &p->parent->children; *pp != p; pp = &(*pp)->sibling)
+      ;
+    *pp = p->sibling;
+  }
+  // P2B - the queues only hold live processes
+  if(swapHead(&pq[p->pri], p->pid) != -1)
+    (void) dequeue(&pq[p->pri]);
+  freeprocmem(p);
+}
+
+// Allocate a proc in state EMBRYO, with the state
+// required to run in the kernel.
+// Return 0 if out of memory.
 static struct proc*
 allocproc(void)
 {
   struct proc *p;
   char *sp;
 
-  acquire(&ptable.lock);
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-    if(p->state == UNUSED)
-      goto found;
-  release(&ptable.lock);
-  return 0;
+  if((p = kcachealloc(ptable.cache)) == 0)
+    return 0;
+  memset(p, 0, sizeof(*p));
+  p->ofile = p->ofile0;
+  p->nofile = NOFILE;
 
-found:
+  // Allocate kernel stack if possible.  The syscall histogram
+  // pages come later, with the first syscall to use each.
+  if((p->kstack = kalloc()) == 0){
+    freeprocmem(p);
+    return 0;
+  }
+
+  acquire(&ptable.lock);
   p->state = EMBRYO;
   p->pid = nextpid++;
+  p->next = ptable.list;
+  if(ptable.list)
+    ptable.list->prev = p;
+  ptable.list = p;
+  p->hnext = ptable.pidhash[p->pid % NPIDHASH];
+  ptable.pidhash[p->pid % NPIDHASH] = p;
   release(&ptable.lock);
 
-  // Allocate kernel stack if possible.
-  if((p->kstack = kalloc()) == 0){
-    p->state = UNUSED;
-    return 0;
-  }
   sp = p->kstack + KSTACKSIZE;
   
   // Leave room for trap frame.
@@ -82,6 +162,32 @@ found:
   return p;
 }
 
+// P2B - put p at the tail of its priority queue.  Returns -1 if
+// the queue is full.  Caller holds ptable.lock.
+static int
+pqadd(struct proc *p)
+{
+  if(enqueue(&pq[p->pri], p->pid) < 0)
+    return -1;
+  p->qtail[p->pri] += 1;
+  return 0;
+}
+
+// Undo a fork() or clone() that failed before np could run:
+// close what it was given and free it.
+static void
+unfork(struct proc *np)
+{
+  fdcloseall(np);
+  if(np->cwd)
+    iput(np->cwd);
+  vmacloseall(np, np->pgdir);
+  vmput(np->pgdir);
+  acquire(&ptable.lock);
+  freeproc(np);
+  release(&ptable.lock);
+}
+
 // Set up first user process.
 void
 userinit(void)
@@ -96,6 +202,7 @@ userinit(void)
     panic("userinit: out of memory?");
   inituvm(p->pgdir, _binary_initcode_start, (int)_binary_initcode_size);
   p->sz = PGSIZE;
+  p->utop = USERTOP;
   memset(p->tf, 0, sizeof(*p->tf));
   p->tf->cs = (SEG_UCODE << 3) | DPL_USER;
   p->tf->ds = (SEG_UDATA << 3) | DPL_USER;
@@ -117,30 +224,140 @@ userinit(void)
   }
   // Set initial process to highest priority and enqueue
   p->pri = 3;
-  p->qtail[p->pri] += 1;
-  enqueue(&pq[p->pri], p->pid);
+  if(pqadd(p) < 0)
+    panic("userinit: pq");
   
   release(&ptable.lock);
 }
 
+// A kernel thread's first scheduling starts here, like forkret,
+// and calls the function kthread() left in its trap frame.
+static void
+kthreadstart(void)
+{
+  release(&ptable.lock);
+  ((void(*)(void))proc->tf->eip)();
+  panic("kthread returned");
+}
+
+// Start a process that runs fn in the kernel and never returns
+// to user space.  Returns its pid.
+int
+kthread(char *name, void (*fn)(void))
+{
+  struct proc *p;
+
+  if((p = allocproc()) == 0)
+    return -1;
+  acquire(&ptable.lock);
+  if((p->pgdir = setupkvm()) == 0){
+    freeproc(p);
+    release(&ptable.lock);
+    return -1;
+  }
+  p->tf->eip = (uint)fn;
+  p->context->eip = (uint)kthreadstart;
+  safestrcpy(p->name, name, sizeof(p->name));
+  p->pri = 3;
+  if(pqadd(p) < 0){
+    freevm(p->pgdir);
+    freeproc(p);
+    release(&ptable.lock);
+    return -1;
+  }
+  p->state = RUNNABLE;
+  release(&ptable.lock);
+  return p->pid;
+}
+
 // Grow current process's memory by n bytes.
 // Return 0 on success, -1 on failure.
+// Threads sharing the page table see the new size too;
+// ptable.lock keeps two of them from growing it at once.
+// While it is shared it cannot shrink (see vmshared()).
 int
 growproc(int n)
 {
   uint sz;
+  struct proc *p;
   
+  acquire(&ptable.lock);
   sz = proc->sz;
   if(n > 0){
+    if(sz + n > proc->utop)
+      goto bad;
     if((sz = allocuvm(proc->pgdir, sz, sz + n)) == 0)
-      return -1;
+      goto bad;
   } else if(n < 0){
+    if(vmshared(proc->pgdir))
+      goto bad;
     if((sz = deallocuvm(proc->pgdir, sz, sz + n)) == 0)
-      return -1;
+      goto bad;
   }
-  proc->sz = sz;
+  for(p = ptable.list; p; p = p->next)
+    if(p->pgdir == proc->pgdir)
+      p->sz = sz;
+  release(&ptable.lock);
   switchuvm(proc);
   return 0;
+
+bad:
+  release(&ptable.lock);
+  return -1;
+}
+
+// Create a thread that shares the current process's page table
+// and runs fcn(arg1, arg2) on the one-page user stack at stack.
+// Like fork, it gets copies of the open files and its own pid;
+// join() reaps it.  Returns the new thread's pid.
+// While threads share it, mappings in the page table are never
+// removed or made copy-on-write (see vmshared()).
+int
+clone(uint fcn, uint arg1, uint arg2, uint stack)
+{
+  struct proc *np;
+  uint ustack[3];
+
+  if(stack % PGSIZE || stack >= proc->sz || proc->sz - stack < PGSIZE)
+    return -1;
+  if(!vmshared(proc->pgdir) && uvmunshare(proc->pgdir, proc->sz) < 0)
+    return -1;
+  if((np = allocproc()) == 0)
+    return -1;
+  np->pgdir = proc->pgdir;
+  kref((char*)np->pgdir);
+  ustack[0] = 0xffffffff;  // fake return PC
+  ustack[1] = arg1;
+  ustack[2] = arg2;
+  if(copyout(np->pgdir, stack + PGSIZE - sizeof(ustack), ustack, sizeof(ustack)) < 0 ||
+     fdcopy(np) < 0){
+    unfork(np);
+    return -1;
+  }
+  np->thread = 1;
+  np->ustack = stack;
+  np->pstatva = proc->pstatva;
+  np->utop = proc->utop;
+  np->sz = proc->sz;
+  *np->tf = *proc->tf;
+  np->tf->eip = fcn;
+  np->tf->esp = stack + PGSIZE - sizeof(ustack);
+  np->cwd = idup(proc->cwd);
+  safestrcpy(np->name, proc->name, sizeof(proc->name));
+
+  acquire(&ptable.lock);
+  np->pri = proc->pri;
+  if(pqadd(np) < 0){
+    release(&ptable.lock);
+    unfork(np);
+    return -1;
+  }
+  np->parent = proc;
+  np->sibling = proc->children;
+  proc->children = np;
+  np->state = RUNNABLE;
+  release(&ptable.lock);
+  return np->pid;
 }
 
 // Create a new process copying p as the parent.
@@ -149,7 +366,7 @@ growproc(int n)
 int
 fork(void)
 {
-  int i, pid;
+  int pid;
   struct proc *np;
 
   // Allocate process.
@@ -158,35 +375,41 @@ fork(void)
 
   // Copy process state from p.
   if((np->pgdir = copyuvm(proc->pgdir, proc->sz)) == 0){
-    kfree(np->kstack);
-    np->kstack = 0;
-    np->state = UNUSED;
+    acquire(&ptable.lock);
+    freeproc(np);
+    release(&ptable.lock);
     return -1;
   }
+  if((proc->pstatva && mapupage(np->pgdir, proc->pstatva, (char*)pstatpg, 0) < 0) ||
+     vmacopy(np) < 0 || fdcopy(np) < 0){
+    unfork(np);
+    return -1;
+  }
+  np->pstatva = proc->pstatva;
+  np->utop = proc->utop;
   np->sz = proc->sz;
-  np->parent = proc;
   *np->tf = *proc->tf;
 
   // Clear %eax so that fork returns 0 in the child.
   np->tf->eax = 0;
 
-  for(i = 0; i < NOFILE; i++)
-    if(proc->ofile[i])
-      np->ofile[i] = filedup(proc->ofile[i]);
   np->cwd = idup(proc->cwd);
- 
-  pid = np->pid;
-  np->state = RUNNABLE;
   safestrcpy(np->name, proc->name, sizeof(proc->name));
   
   //P2B - child proc gets parent proc and enqueue
+  acquire(&ptable.lock);
   np->pri = proc->pri;
-  np->qtail[np->pri] += 1;
-  enqueue(&pq[np->pri], np->pid);
-  // cprintf("fork() pid %d pri %d\n", np->pid, np->pri);
-  
-  cprintf("fork() pid: %d, np->name: %s, np->tf->eax: %d\n", pid, np->name, np->tf->eax); // P3 debug
-  
+  if(pqadd(np) < 0){
+    release(&ptable.lock);
+    unfork(np);
+    return -1;
+  }
+  np->parent = proc;
+  np->sibling = proc->children;
+  proc->children = np;
+  pid = np->pid;
+  np->state = RUNNABLE;
+  release(&ptable.lock);
   return pid;
 }
 
@@ -197,18 +420,13 @@ void
 exit(void)
 {
   struct proc *p;
-  int fd;
 
   if(proc == initproc)
     panic("init exiting");
 
-  // Close all open files.
-  for(fd = 0; fd < NOFILE; fd++){
-    if(proc->ofile[fd]){
-      fileclose(proc->ofile[fd]);
-      proc->ofile[fd] = 0;
-    }
-  }
+  // Write back and drop file mappings, then close all open files.
+  vmacloseall(proc, proc->pgdir);
+  fdcloseall(proc);
 
   iput(proc->cwd);
   proc->cwd = 0;
@@ -219,12 +437,13 @@ exit(void)
   wakeup1(proc->parent);
 
   // Pass abandoned children to init.
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->parent == proc){
-      p->parent = initproc;
-      if(p->state == ZOMBIE)
-        wakeup1(initproc);
-    }
+  while((p = proc->children) != 0){
+    proc->children = p->sibling;
+    p->parent = initproc;
+    p->sibling = initproc->children;
+    initproc->children = p;
+    if(p->state == ZOMBIE)
+      wakeup1(initproc);
   }
 
   // Jump into the scheduler, never to return.
@@ -233,33 +452,70 @@ exit(void)
   panic("zombie exit");
 }
 
+// Add the usage in src to dst.
+static void
+ruadd(struct rusage *dst, struct rusage *src)
+{
+  dst->utime += src->utime;
+  dst->stime += src->stime;
+  dst->inblock += src->inblock;
+  dst->oublock += src->oublock;
+  dst->nvcsw += src->nvcsw;
+  dst->nivcsw += src->nivcsw;
+  dst->minflt += src->minflt;
+}
+
 // Wait for a child process to exit and return its pid.
 // Return -1 if this process has no children.
 int
 wait(void)
+{
+  return waitchild(0, 0);
+}
+
+// Wait for a thread made by clone() to exit and return its pid,
+// storing the address of its user stack at user address stack.
+// Return -1 if this process has no threads.
+int
+join(uint stack)
+{
+  uint ustack;
+  int pid;
+
+  // Store it only now: copyout() may have to copy a page, which
+  // it can't do holding ptable.lock.
+  if((pid = waitchild(1, &ustack)) < 0 ||
+     copyout(proc->pgdir, stack, &ustack, sizeof(ustack)) < 0)
+    return -1;
+  return pid;
+}
+
+// Reap a zombie child: a thread sharing our page table if
+// threads is set, otherwise a process (or a thread of another
+// process, orphaned to us).
+static int
+waitchild(int threads, uint *stack)
 {
   struct proc *p;
   int havekids, pid;
 
   acquire(&ptable.lock);
   for(;;){
-    // Scan through table looking for zombie children.
+    // Scan through children looking for zombies.
     havekids = 0;
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if(p->parent != proc)
+    for(p = proc->children; p; p = p->sibling){
+      if((p->thread && p->pgdir == proc->pgdir) != threads)
         continue;
       havekids = 1;
       if(p->state == ZOMBIE){
         // Found one.
         pid = p->pid;
-        kfree(p->kstack);
-        p->kstack = 0;
-        freevm(p->pgdir);
-        p->state = UNUSED;
-        p->pid = 0;
-        p->parent = 0;
-        p->name[0] = 0;
-        p->killed = 0;
+        if(stack)
+          *stack = p->ustack;
+        ruadd(&proc->cru, &p->ru);
+        ruadd(&proc->cru, &p->cru);
+        vmput(p->pgdir);
+        freeproc(p);
         release(&ptable.lock);
         return pid;
       }
@@ -287,6 +543,7 @@ void
 scheduler(void)
 {
   struct proc *p;
+  int lazy;
 
   for(;;){
     // Enable interrupts on this processor.
@@ -294,8 +551,9 @@ scheduler(void)
     
     // Loop over process table looking for process to run.
     acquire(&ptable.lock);
+    lazy = 0;
     // P2B - rewrite scheduler
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
+    for(p = ptable.list; p; p = p->next) {
       // Get max priority
       int maxPri = -1;
       for (int i = NUM_PQ - 1; i >= 0; i--) {
@@ -338,12 +596,18 @@ scheduler(void)
       proc = p;
       switchuvm(p);
       p->state = RUNNING;
+      trace(TR_SWITCH, p->pid);
       swtch(&cpu->scheduler, proc->context);
-      switchkvm();
       // Process is done running for now.
       // It should have changed its p->state before coming back.
+      // Keep its page table loaded in case another process is
+      // chosen on this pass: p cannot run elsewhere or be freed
+      // while ptable.lock is held.
+      lazy = 1;
       proc = 0;
     }
+    if(lazy)
+      switchkvm();
     release(&ptable.lock);
   }
 }
@@ -373,6 +637,11 @@ sched(void)
   //   }
   // }
   
+  if(proc->state == RUNNABLE)
+    proc->ru.nivcsw++;
+  else if(proc->state == SLEEPING)
+    proc->ru.nvcsw++;
+  trace(TR_SCHED, proc->state);
   swtch(&proc->context, cpu->scheduler);
   cpu->intena = intena;
 }
@@ -423,6 +692,7 @@ sleep(void *chan, struct spinlock *lk)
   // Go to sleep.
   proc->chan = chan;
   proc->state = SLEEPING;
+  trace(TR_SLEEP, (uint)chan);
   sched();
 
   // Tidy up.
@@ -442,9 +712,11 @@ wakeup1(void *chan)
 {
   struct proc *p;
 
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-    if(p->state == SLEEPING && p->chan == chan)
+  for(p = ptable.list; p; p = p->next)
+    if(p->state == SLEEPING && p->chan == chan){
       p->state = RUNNABLE;
+      trace(TR_WAKEUP, p->pid);
+    }
 }
 
 // Wake up all processes sleeping on chan.
@@ -456,6 +728,34 @@ wakeup(void *chan)
   release(&ptable.lock);
 }
 
+// Tell p that a file it is polling may be ready, waking it if
+// it is asleep in pollsleep().
+void
+pollwake(struct proc *p)
+{
+  acquire(&ptable.lock);
+  p->pollev = 1;
+  if(p->state == SLEEPING && p->polling){
+    p->state = RUNNABLE;
+    trace(TR_WAKEUP, p->pid);
+  }
+  release(&ptable.lock);
+}
+
+// Sleep on chan for poll() unless pollwake() has been called
+// since proc->pollev was cleared.
+void
+pollsleep(void *chan)
+{
+  acquire(&ptable.lock);
+  if(!proc->pollev && !proc->killed){
+    proc->polling = 1;
+    sleep(chan, &ptable.lock);
+    proc->polling = 0;
+  }
+  release(&ptable.lock);
+}
+
 // Kill the process with the given pid.
 // Process won't exit until it returns
 // to user space (see trap in trap.c).
@@ -465,15 +765,13 @@ kill(int pid)
   struct proc *p;
 
   acquire(&ptable.lock);
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->pid == pid){
-      p->killed = 1;
-      // Wake process from sleep if necessary.
-      if(p->state == SLEEPING)
-        p->state = RUNNABLE;
-      release(&ptable.lock);
-      return 0;
-    }
+  if((p = findproc(pid)) != 0){
+    p->killed = 1;
+    // Wake process from sleep if necessary.
+    if(p->state == SLEEPING)
+      p->state = RUNNABLE;
+    release(&ptable.lock);
+    return 0;
   }
   release(&ptable.lock);
   return -1;
@@ -498,9 +796,7 @@ procdump(void)
   char *state;
   uint pc[10];
   
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->state == UNUSED)
-      continue;
+  for(p = ptable.list; p; p = p->next){
     if(p->state >= 0 && p->state < NELEM(states) && states[p->state])
       state = states[p->state];
     else
@@ -537,36 +833,35 @@ int sys_setpri(void) {
 
 int setpri(int pid, int pri) {
   struct proc *p;
+  int queued;
   
   // Check for valid priority
   if (pri < 0 || pri > 3) {
     return -1;
   }
   
-  int found = 0;
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if (p->pid == pid) {
-      // do we need to check state of proc?
-      if (p->state == UNUSED) {
-        return -1;
-      }
-      // Dequeue (after swapping to head) from existing PQ, if any
-      if (swapHead(&pq[p->pri], pid) != -1) {
-        (void) dequeue(&pq[p->pri]);
-      }
-      
-      // Enqueue on new PQ
-      p->pri = pri;
-      p->qtail[pri] += 1;
-      (void) enqueue(&pq[pri], pid);
-      
-      found = 1;
-      break; 
-    }
+  acquire(&ptable.lock);
+  if ((p = findproc(pid)) == 0) {
+    release(&ptable.lock);
+    return -1;
+  }
+  // Dequeue (after swapping to head) from existing PQ, if any
+  queued = 0;
+  if (swapHead(&pq[p->pri], pid) != -1) {
+    (void) dequeue(&pq[p->pri]);
+    queued = 1;
   }
-  if (found == 0) {
+  
+  // Enqueue on new PQ, or back on the old one if that is full
+  if (enqueue(&pq[pri], pid) < 0) {
+    if (queued)
+      (void) enqueue(&pq[p->pri], pid);
+    release(&ptable.lock);
     return -1;
   }
+  p->pri = pri;
+  p->qtail[pri] += 1;
+  release(&ptable.lock);
   
   return 0;
 }
@@ -587,34 +882,34 @@ int sys_getpri(void) {
 
 int getpri(int pid) {
   struct proc *p;
+  int pri;
   
-  int found = 0;
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if (p->pid == pid) {
-      if (p->state == UNUSED) {
-        return -1;
-      }
-      found = 1;
-      break;
-    }
-  }
-  if (found == 0) {
-    return -1;
-  }
+  acquire(&ptable.lock);
+  pri = (p = findproc(pid)) ? p->pri : -1;
+  release(&ptable.lock);
   
-  return p->pri;
+  return pri;
 }
 
 int sys_getpinfo(void) {
   struct pstat *status;
   
+  int r;
+  
   if (argptr(0, (void*) &status, sizeof(*status)) < 0) {
     return -1;
   }
   
-  return getpinfo(status);
+  acquire(&ptable.lock);
+  r = getpinfo(status);
+  release(&ptable.lock);
+  return r;
 }
 
+// Fill status from the NPROC processes with the lowest pids,
+// so long-lived ones like init are always there; with more
+// processes than that, the newest are left out.  Slots past
+// the last process are marked unused.  Caller holds ptable.lock.
 int getpinfo(struct pstat * status) {
   if (status == NULL) {
     return -1;
@@ -623,7 +918,11 @@ int getpinfo(struct pstat * status) {
   struct proc *p;
   int i;
   
-  for(p = ptable.proc, i = 0; p < &ptable.proc[NPROC]; p++, i++){
+  memset(status, 0, sizeof(*status));
+  // ptable.list is newest (highest pid) first: start at its end.
+  for(p = ptable.list; p && p->next; p = p->next)
+    ;
+  for(i = 0; p && i < NPROC; p = p->prev, i++){
     status->inuse[i] = (p->state != UNUSED);
     status->pid[i] = p->pid;
     status->priority[i] = p->pri;
@@ -631,15 +930,154 @@ int getpinfo(struct pstat * status) {
     for (int j = 0; j < NUM_PQ; j++) {
       status->ticks[i][j] = p->ticks[j];
       status->qtail[i][j] = p->qtail[j];
-      // cprintf("p - pri %d, ticks %d, qtail %d\n", p, p->ticks[j], p->qtail[j]); // debug
-      // cprintf("pstat - pri %d, ticks %d, qtail %d\n", j, status->ticks[i][j], status->qtail[i][j]); // debug
-    }
-    if (status->inuse[i]) {
-      // cprintf("p - pid %d, state %d\n", p->pid, p->state); // debug
-      // cprintf("pstat - use: %d, pid %d, pri %d, state %d\n", status->inuse[i], status->pid[i], status->priority[i], status->state[i]); // debug    
-      // cprintf("pstat - ticks %d, qtail %d\n", status->ticks[i][status->priority[i]], status->qtail[i][status->priority[i]]); // debug
     }
   }
   
   return 0;
-}
\ No newline at end of file
+}
+
+// Copy syscall statistics for pid into st.  pid 0 asks for the
+// system-wide totals, summed over the per-cpu counters.
+// Returns -1 if pid is not a live process.
+int
+getsysstat(int pid, struct sysstat *st)
+{
+  struct proc *p;
+  struct cpu *c;
+  int n, b;
+
+  if(pid == 0){
+    memset(st, 0, sizeof(*st));
+    for(c = cpus; c < cpus+ncpu; c++){
+      for(n = 0; n < NSYSCALL; n++){
+        st->count[n] += c->sysstat.count[n];
+        st->cycles[n] += c->sysstat.cycles[n];
+        for(b = 0; b < NSYSHIST; b++)
+          st->hist[n][b] += c->sysstat.hist[n][b];
+      }
+    }
+    return 0;
+  }
+
+  acquire(&ptable.lock);
+  if((p = findproc(pid)) == 0){
+    release(&ptable.lock);
+    return -1;
+  }
+  memmove(st->count, p->sccount, sizeof(st->count));
+  memmove(st->cycles, p->sccycles, sizeof(st->cycles));
+  for(n = 0; n < NSYSCALL; n++){
+    if(p->schist[n/HISTROWS])
+      memmove(st->hist[n], p->schist[n/HISTROWS][n%HISTROWS], sizeof(st->hist[n]));
+    else
+      memset(st->hist[n], 0, sizeof(st->hist[n]));
+  }
+  release(&ptable.lock);
+  return 0;
+}
+
+// Map the pstat snapshot page read-only into the current
+// process just below its other top-down mappings.
+// Returns its user address (the same one if already mapped),
+// or -1 if the heap has grown into the space.
+int
+mappinfo(void)
+{
+  uint va;
+
+  if(proc->pstatva)
+    return proc->pstatva;
+  if(vmshared(proc->pgdir))
+    return -1;  // threads' utops would collide
+  va = proc->utop - PGSIZE;
+  if(va < PGROUNDUP(proc->sz))
+    return -1;
+  if(mapupage(proc->pgdir, va, (char*)pstatpg, 0) < 0)
+    return -1;
+  proc->utop = va;
+  proc->pstatva = va;
+  pstatlive = 1;
+  return va;
+}
+
+// Republish the pstat snapshot.  Called every clock tick.
+// Readers never take a lock: they retry if seq was odd or
+// changed while they copied (see readpinfo() in ulib.c).
+void
+pstatpublish(void)
+{
+  if(!pstatlive)
+    return;
+  acquire(&ptable.lock);
+  pstatpg->seq++;
+  __sync_synchronize();
+  getpinfo(&pstatpg->st);
+  __sync_synchronize();
+  pstatpg->seq++;
+  release(&ptable.lock);
+}
+
+// Map a zeroed, writable submission ring page into the current
+// process just below utop.  The ring is not inherited by fork.
+// The page table holds the only reference, so freevm frees it.
+int
+ringsetup(void)
+{
+  char *mem;
+  uint va;
+
+  if(proc->ring)
+    return proc->ringva;
+  if(vmshared(proc->pgdir))
+    return -1;
+  va = proc->utop - PGSIZE;
+  if(va < PGROUNDUP(proc->sz))
+    return -1;
+  if((mem = kalloc()) == 0)
+    return -1;
+  memset(mem, 0, PGSIZE);
+  if(mapupage(proc->pgdir, va, mem, PTE_W) < 0){
+    kfree(mem);
+    return -1;
+  }
+  kfree(mem);
+  proc->utop = va;
+  proc->ring = (struct ring*)mem;
+  proc->ringva = va;
+  return va;
+}
+
+// If the int at user address addr still holds val, sleep until
+// futexwake(addr).  The channel is the word's physical address,
+// so threads and processes sharing the page meet there.
+// Returns 0 after sleeping, -1 if *addr had changed.
+int
+futexwait(int *addr, int val)
+{
+  char *chan;
+
+  if((chan = uva2ka(proc->pgdir, (char*)PGROUNDDOWN((uint)addr))) == 0)
+    return -1;
+  chan += (uint)addr % PGSIZE;
+  acquire(&ptable.lock);
+  if(*addr != val || proc->killed){
+    release(&ptable.lock);
+    return -1;
+  }
+  sleep(chan, &ptable.lock);
+  release(&ptable.lock);
+  return 0;
+}
+
+// Wake every process sleeping in futexwait(addr).
+int
+futexwake(int *addr)
+{
+  char *chan;
+
+  if((chan = uva2ka(proc->pgdir, (char*)PGROUNDDOWN((uint)addr))) == 0)
+    return -1;
+  chan += (uint)addr % PGSIZE;
+  wakeup(chan);
+  return 0;
+}
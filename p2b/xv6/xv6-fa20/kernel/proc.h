@@ -1,16 +1,20 @@
 #ifndef _PROC_H_
 #define _PROC_H_
 // Segments in proc->gdt.
-// Also known to bootasm.S and trapasm.S
+// Also known to bootasm.S and trapasm.S.
+// SYSENTER/SYSEXIT require KCODE, KDATA, UCODE, UDATA in that order.
 #define SEG_KCODE 1  // kernel code
 #define SEG_KDATA 2  // kernel data+stack
-#define SEG_KCPU  3  // kernel per-cpu data
-#define SEG_UCODE 4  // user code
-#define SEG_UDATA 5  // user data+stack
+#define SEG_UCODE 3  // user code
+#define SEG_UDATA 4  // user data+stack
+#define SEG_KCPU  5  // kernel per-cpu data
 #define SEG_TSS   6  // this process's task state
 #define NSEGS     7
 
 #include "pstat.h"
+#include "sysstat.h"
+#include "rusage.h"
+#include "ring.h"
 
 // Per-CPU state
 struct cpu {
@@ -21,6 +25,8 @@ struct cpu {
   volatile uint booted;        // Has the CPU started?
   int ncli;                    // Depth of pushcli nesting.
   int intena;                  // Were interrupts enabled before pushcli?
+  struct sysstat sysstat;      // Syscalls completed on this cpu
+  int sysenter;                // Is the SYSENTER path set up?
 
   // Cpu-local storage variables; see below
   struct cpu *cpu;
@@ -59,6 +65,22 @@ struct context {
   uint eip;
 };
 
+// A file mapping made by mmap(), whose pages are faulted in on
+// first touch, or a shared memory segment attached by shmat(),
+// mapped in full.  end == 0 marks an unused slot.
+struct vma {
+  uint start, end;             // Page-aligned user addresses
+  struct file *f;              // Mapped file, or
+  struct shm *shm;             // shared memory segment
+  uint off;                    // File offset of start
+  int prot;                    // PROT_READ, PROT_WRITE
+  int flags;                   // MAP_SHARED or MAP_PRIVATE
+};
+
+// A process's syscall latency histograms take two pages.
+#define NHISTPG   2
+#define HISTROWS  (NSYSCALL/NHISTPG)
+
 // Per-process state
 struct proc {
   uint sz;                     // Size of process memory (bytes)
@@ -67,11 +89,24 @@ struct proc {
   enum procstate state;        // Process state
   volatile int pid;            // Process ID
   struct proc *parent;         // Parent process
+  int thread;                  // Made by clone(): shares parent's pgdir
+  uint ustack;                 // User stack given to clone()
+  struct proc *children;       // First child
+  struct proc *sibling;        // Next child of parent
+  struct proc *next, *prev;    // On ptable.list
+  struct proc *hnext;          // Next in pid hash chain
   struct trapframe *tf;        // Trap frame for current syscall
   struct context *context;     // swtch() here to run process
   void *chan;                  // If non-zero, sleeping on chan
   int killed;                  // If non-zero, have been killed
-  struct file *ofile[NOFILE];  // Open files
+  int pollev;                  // pollwake() since poll() last looked
+  int polling;                 // In pollsleep()
+  struct file **ofile;         // Open files, indexed by fd
+  int nofile;                  // Size of ofile
+  struct file *ofile0[NOFILE]; // Initial ofile
+  uint fdmap[NOFILEMAX/32];    // Bit set for each fd in use
+  uint fdfull;                 // Bit set for each full fdmap word
+  struct vma vma[NVMA];        // File and shared memory mappings
   struct inode *cwd;           // Current directory
   char name[16];               // Process name (debugging)
   
@@ -79,12 +114,23 @@ struct proc {
   int pri;                    // Scheduling priority queue
   int ticks[4];                // Ticks per priority queue
   int qtail[4];                // Times moved to tail per priority queue
+
+  uint sccount[NSYSCALL];      // Syscalls entered, by number
+  uint64 sccycles[NSYSCALL];   // TSC cycles spent in completed syscalls
+  uint (*schist[NHISTPG])[NSYSHIST];  // Latency histograms, HISTROWS per page, made on first use
+  uint utop;                   // Heap may grow up to here; pages above are mapped top-down
+  uint pstatva;                // Where the pstat snapshot page is mapped, or 0
+  struct rusage ru;            // Resources used by this process
+  struct rusage cru;           // Resources used by waited-for children
+  struct ring *ring;           // Submission ring page, or 0
+  uint ringva;                 // Where the ring is mapped
 };
 
 // Process memory is laid out contiguously, low addresses first:
 //   text
 //   original data and bss
 //   fixed-size stack
-//   expandable heap
+//   expandable heap (up to utop)
+//   special pages mapped down from USERTOP (pstat snapshot)
 
 #endif // _PROC_H_
@@ -0,0 +1,59 @@
+// Sampling profiler driven by the clock interrupt.
+//
+// While profiling is on, trap() hands every clock interrupt's
+// trap frame to profsample(), which records the interrupted pc
+// and, for kernel code, the caller pcs from the %ebp chain.
+// Samples go in per-cpu rings (see cpuring.c), so adding one
+// takes no lock.  Once a ring fills, the oldest are overwritten.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "x86.h"
+#include "proc.h"
+#include "prof.h"
+#include "cpuring.h"
+
+static struct profsample profsamples[NCPU][NPROFSAMPLE];
+static struct cpuring profring = {
+  (char*)profsamples, sizeof(struct profsample), NPROFSAMPLE
+};
+
+// Record one sample for this cpu.  Called with interrupts off.
+void
+profsample(struct trapframe *tf)
+{
+  struct profsample *s;
+  uint pcs[10];
+  int i;
+
+  if((s = cpuringput(&profring)) == 0)
+    return;
+  s->eip = tf->eip;
+  s->pid = proc ? proc->pid : 0;
+  s->kernel = (tf->cs & 3) == 0;
+  if(s->kernel)
+    getcallerpcs((uint*)tf->ebp + 2, pcs);
+  else
+    memset(pcs, 0, sizeof(pcs));
+  for(i = 0; i < PROFDEPTH; i++)
+    s->pcs[i] = pcs[i];
+}
+
+// Start, stop or reset the profiler.
+// PROF_STOP returns the number of samples taken,
+// including any that were overwritten.
+int
+profctl(int cmd)
+{
+  return cpuringctl(&profring, cmd);
+}
+
+// Copy up to max retained samples, oldest first per cpu,
+// into dst.  Returns the number copied.
+int
+profread(struct profsample *dst, int max)
+{
+  return cpuringread(&profring, dst, max);
+}
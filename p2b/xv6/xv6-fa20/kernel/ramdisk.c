@@ -0,0 +1,99 @@
+// RAM disk: block device RAMDEV, RAMDISKSIZE sectors kept in
+// kalloc'd pages.  It is formatted at boot as an empty file
+// system (see mkfs.c) and can be mounted, for temporary files
+// or for timing the file system without a disk underneath.
+// All its pages are allocated at boot, so that writing a file
+// in memory never fails for want of memory.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "stat.h"
+#include "mmu.h"
+#include "spinlock.h"
+#include "buf.h"
+#include "blkdev.h"
+#include "fs.h"
+
+#define NRAMPG   (RAMDISKSIZE*BSIZE/PGSIZE)
+#define NRAMINODE 64
+
+static struct {
+  struct spinlock lock;
+  char *pages[NRAMPG];
+} ram;
+
+static struct blkdev ramdev;
+
+// Return the memory holding sector n.
+static char*
+ramsector(uint n)
+{
+  if(n >= RAMDISKSIZE)
+    panic("ramdisk: sector out of range");
+  return ram.pages[n / (PGSIZE/BSIZE)] + (n % (PGSIZE/BSIZE)) * BSIZE;
+}
+
+// Transfers finish at once.  Caller holds ram.lock.
+static void
+ramsubmit(struct blkdev *d, struct buf *b)
+{
+  if(b->flags & B_DIRTY)
+    memmove(ramsector(b->sector), b->data, BSIZE);
+  else
+    memmove(b->data, ramsector(b->sector), BSIZE);
+  blkdone(b);
+}
+
+// Lay out an empty file system the way mkfs does: boot block,
+// super block, inodes, bitmap, then data, starting with the
+// root directory's one block.
+static void
+ramformat(void)
+{
+  struct superblock *sb;
+  struct dinode *dip;
+  struct dirent *de;
+  uint used, b;
+  char *bitmap;
+
+  used = NRAMINODE/IPB + 3 + RAMDISKSIZE/BPB + 1;
+  sb = (struct superblock*)ramsector(1);
+  sb->size = RAMDISKSIZE;
+  sb->nblocks = RAMDISKSIZE - used;
+  sb->ninodes = NRAMINODE;
+
+  bitmap = ramsector(BBLOCK(0, NRAMINODE));
+  for(b = 0; b <= used; b++)
+    bitmap[b/8] |= 1 << (b%8);
+
+  dip = (struct dinode*)ramsector(IBLOCK(ROOTINO)) + ROOTINO%IPB;
+  dip->type = T_DIR;
+  dip->nlink = 1;
+  dip->size = 2*sizeof(*de);
+  dip->addrs[0] = used;
+
+  de = (struct dirent*)ramsector(used);
+  de[0].inum = ROOTINO;
+  safestrcpy(de[0].name, ".", DIRSIZ);
+  de[1].inum = ROOTINO;
+  safestrcpy(de[1].name, "..", DIRSIZ);
+}
+
+void
+ramdiskinit(void)
+{
+  int i;
+
+  initlock(&ram.lock, "ramdisk");
+  for(i = 0; i < NRAMPG; i++){
+    if((ram.pages[i] = kalloc()) == 0)
+      panic("ramdiskinit: out of memory");
+    memset(ram.pages[i], 0, PGSIZE);
+  }
+  ramformat();
+  ramdev.lock = &ram.lock;
+  ramdev.submit = ramsubmit;
+  ramdev.size = RAMDISKSIZE;
+  blkregister(RAMDEV, &ramdev);
+}
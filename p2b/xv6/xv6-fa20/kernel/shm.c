@@ -0,0 +1,153 @@
+// Shared memory segments.
+//
+// A segment is a set of zeroed pages named by an integer key.
+// shmat() maps a segment, creating it on first use, into the
+// calling process below proc->utop, recording it as a vma so
+// that fork, exec and exit handle it like a file mapping.
+// Each mapping holds a reference to every page and the segment
+// holds one more; the segment is freed when its last mapping
+// goes, and freevm() frees each page with its last reference.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "mman.h"
+
+struct shm {
+  int key;
+  int ref;                // mappings
+  uint npage;
+  char *pages[NSHMPG];
+};
+
+struct {
+  struct spinlock lock;
+  struct shm seg[NSHM];
+} shmtab;
+
+void
+shminit(void)
+{
+  initlock(&shmtab.lock, "shm");
+}
+
+// Find the segment named key, creating it with npage zeroed
+// pages if there is none, and take a reference to it.
+static struct shm*
+shmget(int key, uint npage)
+{
+  struct shm *s, *fs;
+
+  acquire(&shmtab.lock);
+  fs = 0;
+  for(s = shmtab.seg; s < &shmtab.seg[NSHM]; s++){
+    if(s->ref > 0 && s->key == key){
+      if(npage > s->npage){
+        release(&shmtab.lock);
+        return 0;
+      }
+      s->ref++;
+      release(&shmtab.lock);
+      return s;
+    }
+    if(s->ref == 0 && fs == 0)
+      fs = s;
+  }
+  if((s = fs) == 0){
+    release(&shmtab.lock);
+    return 0;
+  }
+  for(s->npage = 0; s->npage < npage; s->npage++){
+    if((s->pages[s->npage] = kalloc()) == 0){
+      while(s->npage > 0)
+        kfree(s->pages[--s->npage]);
+      release(&shmtab.lock);
+      return 0;
+    }
+    memset(s->pages[s->npage], 0, PGSIZE);
+  }
+  s->key = key;
+  s->ref = 1;
+  release(&shmtab.lock);
+  return s;
+}
+
+// Take another reference to s, for a copied mapping.
+void
+shmdup(struct shm *s)
+{
+  acquire(&shmtab.lock);
+  s->ref++;
+  release(&shmtab.lock);
+}
+
+// Drop a reference to s, freeing it with the last.
+void
+shmput(struct shm *s)
+{
+  uint i;
+
+  acquire(&shmtab.lock);
+  if(--s->ref == 0){
+    for(i = 0; i < s->npage; i++)
+      kfree(s->pages[i]);
+    s->npage = 0;
+  }
+  release(&shmtab.lock);
+}
+
+// Map at least size bytes of the segment named key into the
+// current process, creating it if needed.  Returns the address,
+// or -1.
+int
+shmat(int key, uint size)
+{
+  struct shm *s;
+  struct vma *v;
+  uint npage, va, i;
+
+  npage = PGROUNDUP(size) / PGSIZE;
+  if(npage == 0 || npage > NSHMPG || vmshared(proc->pgdir))
+    return -1;
+  for(v = proc->vma; v < &proc->vma[NVMA]; v++)
+    if(v->end == 0)
+      break;
+  if(v == &proc->vma[NVMA])
+    return -1;
+  if((s = shmget(key, npage)) == 0)
+    return -1;
+  npage = s->npage;
+  if(npage*PGSIZE > proc->utop || (va = proc->utop - npage*PGSIZE) < PGROUNDUP(proc->sz)){
+    shmput(s);
+    return -1;
+  }
+  for(i = 0; i < npage; i++){
+    if(mapupage(proc->pgdir, va + i*PGSIZE, s->pages[i], PTE_W) < 0){
+      deallocuvm(proc->pgdir, va + i*PGSIZE, va);
+      shmput(s);
+      return -1;
+    }
+  }
+  v->start = va;
+  v->end = va + npage*PGSIZE;
+  v->shm = s;
+  v->prot = PROT_READ|PROT_WRITE;
+  v->flags = MAP_SHARED;
+  proc->utop = va;
+  return va;
+}
+
+// Unmap the segment mapped at addr.
+int
+shmdt(uint addr)
+{
+  struct vma *v;
+
+  for(v = proc->vma; v < &proc->vma[NVMA]; v++)
+    if(v->end && v->shm && v->start == addr)
+      return munmap(addr, v->end - v->start);
+  return -1;
+}
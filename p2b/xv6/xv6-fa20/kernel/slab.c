@@ -0,0 +1,126 @@
+// Object caches for kernel structures smaller than a page.
+//
+// Each cache hands out objects of one size, carved from pages
+// taken with kalloc().  Free objects sit on a cache-wide list
+// protected by the cache's lock, and each cpu keeps a small
+// magazine of free objects it can use without locking.  A cpu
+// goes to the shared list only to refill an empty magazine or
+// spill half of a full one.  Pages are never given back to
+// kalloc(), so a cache's footprint is its high-water mark.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "x86.h"
+#include "proc.h"
+#include "spinlock.h"
+
+#define NKCACHE  8   // caches in the system
+#define NMAG     16  // objects in each per-cpu magazine
+
+struct kobj {
+  struct kobj *next;
+};
+
+struct kcache {
+  struct spinlock lock;
+  char *name;
+  uint size;              // object size, rounded up
+  struct kobj *free;      // shared free list
+  uint npage;             // pages taken from kalloc
+  struct {
+    int n;
+    void *obj[NMAG];
+  } mag[NCPU];            // per-cpu magazines
+};
+
+static struct kcache kcaches[NKCACHE];
+static int nkcache;
+
+// Make a cache of objects of the given size.
+// Called only during boot, before other cpus start.
+struct kcache*
+kcachecreate(char *name, uint size)
+{
+  struct kcache *c;
+
+  if(nkcache == NKCACHE || size > PGSIZE)
+    panic("kcachecreate");
+  c = &kcaches[nkcache++];
+  initlock(&c->lock, name);
+  c->name = name;
+  if(size < sizeof(struct kobj))
+    size = sizeof(struct kobj);
+  c->size = (size + 3) & ~3;
+  return c;
+}
+
+// Carve a fresh page into free objects.  Caller holds c->lock.
+static int
+kcachegrow(struct kcache *c)
+{
+  char *p, *o;
+  struct kobj *k;
+
+  if((p = kalloc()) == 0)
+    return -1;
+  for(o = p; o + c->size <= p + PGSIZE; o += c->size){
+    k = (struct kobj*)o;
+    k->next = c->free;
+    c->free = k;
+  }
+  c->npage++;
+  return 0;
+}
+
+// Allocate one object, or return 0 if out of memory.
+// The contents are not initialized.
+void*
+kcachealloc(struct kcache *c)
+{
+  struct kobj *k;
+  void *p;
+  int i;
+
+  pushcli();
+  i = cpu - cpus;
+  if(c->mag[i].n == 0){
+    acquire(&c->lock);
+    while(c->mag[i].n < NMAG/2){
+      if(c->free == 0 && kcachegrow(c) < 0)
+        break;
+      k = c->free;
+      c->free = k->next;
+      c->mag[i].obj[c->mag[i].n++] = k;
+    }
+    release(&c->lock);
+  }
+  p = 0;
+  if(c->mag[i].n > 0)
+    p = c->mag[i].obj[--c->mag[i].n];
+  popcli();
+  return p;
+}
+
+// Return an object to its cache.
+void
+kcachefree(struct kcache *c, void *p)
+{
+  struct kobj *k;
+  int i;
+
+  pushcli();
+  i = cpu - cpus;
+  if(c->mag[i].n == NMAG){
+    acquire(&c->lock);
+    while(c->mag[i].n > NMAG/2){
+      k = c->mag[i].obj[--c->mag[i].n];
+      k->next = c->free;
+      c->free = k;
+    }
+    release(&c->lock);
+  }
+  c->mag[i].obj[c->mag[i].n++] = p;
+  popcli();
+}
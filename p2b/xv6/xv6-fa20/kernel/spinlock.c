@@ -7,6 +7,7 @@
 #include "mmu.h"
 #include "proc.h"
 #include "spinlock.h"
+#include "trace.h"
 
 void
 initlock(struct spinlock *lk, char *name)
@@ -29,9 +30,13 @@ acquire(struct spinlock *lk)
 
   // The xchg is atomic.
   // It also serializes, so that reads after acquire are not
-  // reordered before it. 
-  while(xchg(&lk->locked, 1) != 0)
-    ;
+  // reordered before it.  Only contended acquires are traced.
+  if(xchg(&lk->locked, 1) != 0){
+    trace(TR_LOCKWAIT, (uint)lk);
+    while(xchg(&lk->locked, 1) != 0)
+      ;
+    trace(TR_LOCKGOT, (uint)lk);
+  }
 
   // Record info about lock acquisition for debugging.
   lk->cpu = cpu;
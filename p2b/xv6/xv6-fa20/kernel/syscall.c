@@ -6,12 +6,19 @@
 #include "x86.h"
 #include "syscall.h"
 #include "sysfunc.h"
+#include "traps.h"
 
 // User code makes a system call with INT T_SYSCALL.
 // System call number in %eax.
 // Arguments on the stack, from the user call to the C
 // library system call function. The saved user %esp points
 // to a saved program counter, and then the first argument.
+//
+// The *_fast stubs use SYSENTER instead (see sysentry in
+// trapasm.S).  They pass the first four arguments in %ebx,
+// %esi, %edi and %ebp; the saved user %esp points at those
+// four registers pushed by the stub, its return pc, and
+// then the first argument.
 
 // Fetch the int at addr from process p.
 int
@@ -23,21 +30,22 @@ fetchint(struct proc *p, uint addr, int *ip)
   return 0;
 }
 
-// Fetch the nul-terminated string at addr from process p.
-// Doesn't actually copy the string - just sets *pp to point at it.
-// Returns length of string, not including nul.
+// Copy the nul-terminated string at addr from process p into
+// buf, which has room for max bytes.  Each byte is checked as it
+// is copied: a thread sharing the memory can change the string
+// meanwhile.  Returns length of string, not including nul, or -1
+// if it runs past p->sz or does not fit.
 int
-fetchstr(struct proc *p, uint addr, char **pp)
+fetchstr(struct proc *p, uint addr, char *buf, int max)
 {
-  char *s, *ep;
+  int i;
 
-  if(addr >= p->sz)
-    return -1;
-  *pp = (char*)addr;
-  ep = (char*)p->sz;
-  for(s = *pp; s < ep; s++)
-    if(*s == 0)
-      return s - *pp;
+  for(i = 0; i < max; i++){
+    if(addr + i >= p->sz || addr + i < addr)
+      return -1;
+    if((buf[i] = *(char*)(addr + i)) == 0)
+      return i;
+  }
   return -1;
 }
 
@@ -45,9 +53,32 @@ fetchstr(struct proc *p, uint addr, char **pp)
 int
 argint(int n, int *ip)
 {
+  if(proc->tf->trapno == T_SYSENTER){
+    switch(n){
+    case 0: *ip = proc->tf->ebx; return 0;
+    case 1: *ip = proc->tf->esi; return 0;
+    case 2: *ip = proc->tf->edi; return 0;
+    case 3: *ip = proc->tf->ebp; return 0;
+    }
+    return fetchint(proc, proc->tf->esp + 20 + 4*n, ip);
+  }
   return fetchint(proc, proc->tf->esp + 4 + 4*n, ip);
 }
 
+// Check that the size bytes at addr are memory the kernel may
+// use directly: heap below proc->sz, or a mapping (see
+// vmarange()), which must be writable if write is set.
+// Returns 0 or -1.
+int
+checkuptr(uint addr, int size, int write)
+{
+  if(size < 0)
+    return -1;
+  if(addr < proc->sz && addr+size <= proc->sz && addr+size >= addr)
+    return 0;
+  return vmarange(addr, size, write);
+}
+
 // Fetch the nth word-sized system call argument as a pointer
 // to a block of memory of size n bytes.  Check that the pointer
 // lies within the process address space.
@@ -58,23 +89,36 @@ argptr(int n, char **pp, int size)
   
   if(argint(n, &i) < 0)
     return -1;
-  if((uint)i >= proc->sz || (uint)i+size > proc->sz)
+  if(checkuptr(i, size, 1) < 0)
     return -1;
   *pp = (char*)i;
   return 0;
 }
 
-// Fetch the nth word-sized system call argument as a string pointer.
-// Check that the pointer is valid and the string is nul-terminated.
-// (There is no shared writable memory, so the string can't change
-// between this check and being used by the kernel.)
+// Like argptr(), for a block the kernel only reads, which may
+// be in a read-only mapping.
 int
-argstr(int n, char **pp)
+argrdptr(int n, char **pp, int size)
+{
+  int i;
+
+  if(argint(n, &i) < 0)
+    return -1;
+  if(checkuptr(i, size, 0) < 0)
+    return -1;
+  *pp = (char*)i;
+  return 0;
+}
+
+// Fetch the nth word-sized system call argument as a string pointer
+// and copy the string into buf, which has room for max bytes.
+int
+argstr(int n, char *buf, int max)
 {
   int addr;
   if(argint(n, &addr) < 0)
     return -1;
-  return fetchstr(proc, addr, pp);
+  return fetchstr(proc, addr, buf, max);
 }
 
 // syscall function declarations moved to sysfunc.h so compiler
@@ -107,18 +151,89 @@ static int (*syscalls[])(void) = {
 [SYS_getpri]  sys_getpri,
 [SYS_setpri]  sys_setpri,
 [SYS_getpinfo]  sys_getpinfo,
+[SYS_getsysstat] sys_getsysstat,
+[SYS_mappinfo] sys_mappinfo,
+[SYS_profctl] sys_profctl,
+[SYS_profread] sys_profread,
+[SYS_tracectl] sys_tracectl,
+[SYS_traceread] sys_traceread,
+[SYS_getrusage] sys_getrusage,
+[SYS_ringsetup] sys_ringsetup,
+[SYS_ringenter] sys_ringenter,
+[SYS_readv]   sys_readv,
+[SYS_writev]  sys_writev,
+[SYS_pread]   sys_pread,
+[SYS_pwrite]  sys_pwrite,
+[SYS_mmap]    sys_mmap,
+[SYS_munmap]  sys_munmap,
+[SYS_shmat]   sys_shmat,
+[SYS_shmdt]   sys_shmdt,
+[SYS_clone]   sys_clone,
+[SYS_join]    sys_join,
+[SYS_futexwait] sys_futexwait,
+[SYS_futexwake] sys_futexwake,
+[SYS_fadvise] sys_fadvise,
+[SYS_fcntl]   sys_fcntl,
+[SYS_poll]    sys_poll,
+[SYS_dmesg]   sys_dmesg,
+[SYS_mount]   sys_mount,
 };
 
+// Log2 bucket for a latency of c cycles; the last bucket
+// also collects everything slower.
+static int
+sysstat_bucket(uint64 c)
+{
+  int b;
+
+  for(b = 0; b < NSYSHIST-1 && (c >> (b+1)) != 0; b++)
+    ;
+  return b;
+}
+
+// Charge a completed syscall to the current process and cpu.
+// Interrupts stay off so a yield cannot move us to another
+// cpu halfway through the cpu's counters.  The process's
+// histogram page for num is allocated here on first use; if
+// memory is short its latency just goes uncounted.
+static void
+sysstat_record(int num, uint64 cycles)
+{
+  uint (*h)[NSYSHIST];
+  int b;
+
+  b = sysstat_bucket(cycles);
+  if((h = proc->schist[num/HISTROWS]) == 0 && (h = (void*)kalloc()) != 0){
+    memset(h, 0, PGSIZE);
+    proc->schist[num/HISTROWS] = h;
+  }
+  pushcli();
+  proc->sccycles[num] += cycles;
+  if(h)
+    h[num%HISTROWS][b]++;
+  cpu->sysstat.cycles[num] += cycles;
+  cpu->sysstat.hist[num][b]++;
+  popcli();
+}
+
 // Called on a syscall trap. Checks that the syscall number (passed via eax)
 // is valid and then calls the appropriate handler for the syscall.
 void
 syscall(void)
 {
   int num;
+  uint64 start;
   
   num = proc->tf->eax;
   if(num > 0 && num < NELEM(syscalls) && syscalls[num] != NULL) {
+    // Count on entry: exit() and a failed exec() never come back.
+    pushcli();
+    proc->sccount[num]++;
+    cpu->sysstat.count[num]++;
+    popcli();
+    start = rdtsc();
     proc->tf->eax = syscalls[num]();
+    sysstat_record(num, rdtsc() - start);
   } else {
     cprintf("%d %s: unknown sys call %d\n",
             proc->pid, proc->name, num);
@@ -8,6 +8,9 @@
 #include "file.h"
 #include "fcntl.h"
 #include "sysfunc.h"
+#include "uio.h"
+#include "mman.h"
+#include "poll.h"
 
 // Fetch the nth word-sized system call argument as a file descriptor
 // and return both the descriptor and the corresponding struct file.
@@ -19,7 +22,7 @@ argfd(int n, int *pfd, struct file **pf)
 
   if(argint(n, &fd) < 0)
     return -1;
-  if(fd < 0 || fd >= NOFILE || (f=proc->ofile[fd]) == 0)
+  if(fd < 0 || fd >= proc->nofile || (f=proc->ofile[fd]) == 0)
     return -1;
   if(pfd)
     *pfd = fd;
@@ -28,22 +31,6 @@ argfd(int n, int *pfd, struct file **pf)
   return 0;
 }
 
-// Allocate a file descriptor for the given file.
-// Takes over file reference from caller on success.
-static int
-fdalloc(struct file *f)
-{
-  int fd;
-
-  for(fd = 0; fd < NOFILE; fd++){
-    if(proc->ofile[fd] == 0){
-      proc->ofile[fd] = f;
-      return fd;
-    }
-  }
-  return -1;
-}
-
 int
 sys_dup(void)
 {
@@ -77,11 +64,162 @@ sys_write(void)
   int n;
   char *p;
 
-  if(argfd(0, 0, &f) < 0 || argint(2, &n) < 0 || argptr(1, &p, n) < 0)
+  if(argfd(0, 0, &f) < 0 || argint(2, &n) < 0 || argrdptr(1, &p, n) < 0)
     return -1;
   return filewrite(f, p, n);
 }
 
+// Fetch and check readv/writev arguments: fd, then an array
+// of cnt iovecs, copied into iov so they cannot change.  The
+// buffers are written for readv, only read (write set) for writev.
+static int
+argiov(struct file **pf, struct iovec *iov, int *pcnt, int write)
+{
+  struct iovec *uiov;
+  int i, cnt;
+
+  if(argfd(0, 0, pf) < 0 || argint(2, &cnt) < 0)
+    return -1;
+  if(cnt < 0 || cnt > IOV_MAX)
+    return -1;
+  if(argrdptr(1, (void*)&uiov, cnt*sizeof(*uiov)) < 0)
+    return -1;
+  for(i = 0; i < cnt; i++){
+    iov[i] = uiov[i];
+    if(checkuptr((uint)iov[i].base, iov[i].len, !write) < 0)
+      return -1;
+  }
+  *pcnt = cnt;
+  return 0;
+}
+
+int
+sys_readv(void)
+{
+  struct file *f;
+  struct iovec iov[IOV_MAX];
+  int cnt;
+
+  if(argiov(&f, iov, &cnt, 0) < 0)
+    return -1;
+  return fileiov(f, iov, cnt, -1, 0);
+}
+
+int
+sys_writev(void)
+{
+  struct file *f;
+  struct iovec iov[IOV_MAX];
+  int cnt;
+
+  if(argiov(&f, iov, &cnt, 1) < 0)
+    return -1;
+  return fileiov(f, iov, cnt, -1, 1);
+}
+
+// Fetch and check pread/pwrite arguments: fd, buffer, length,
+// offset.  The file's own offset is neither used nor changed.
+static int
+argpio(struct file **pf, struct iovec *iov, int *poff, int write)
+{
+  int n, r;
+  char *p;
+
+  if(argfd(0, 0, pf) < 0 || argint(2, &n) < 0 || n < 0)
+    return -1;
+  r = write ? argrdptr(1, &p, n) : argptr(1, &p, n);
+  if(r < 0 || argint(3, poff) < 0 || *poff < 0)
+    return -1;
+  iov->base = p;
+  iov->len = n;
+  return 0;
+}
+
+int
+sys_pread(void)
+{
+  struct file *f;
+  struct iovec iov;
+  int off;
+
+  if(argpio(&f, &iov, &off, 0) < 0)
+    return -1;
+  return fileiov(f, &iov, 1, off, 0);
+}
+
+int
+sys_pwrite(void)
+{
+  struct file *f;
+  struct iovec iov;
+  int off;
+
+  if(argpio(&f, &iov, &off, 1) < 0)
+    return -1;
+  return fileiov(f, &iov, 1, off, 1);
+}
+
+int
+sys_fadvise(void)
+{
+  struct file *f;
+  int off, len, advice;
+
+  if(argfd(0, 0, &f) < 0 || argint(1, &off) < 0 || argint(2, &len) < 0 ||
+     argint(3, &advice) < 0 || off < 0 || len < 0)
+    return -1;
+  return fileadvise(f, off, len, advice);
+}
+
+int
+sys_fcntl(void)
+{
+  struct file *f;
+  int cmd, arg, mode;
+
+  if(argfd(0, 0, &f) < 0 || argint(1, &cmd) < 0 || argint(2, &arg) < 0)
+    return -1;
+  switch(cmd){
+  case F_GETFL:
+    mode = f->readable ? (f->writable ? O_RDWR : O_RDONLY) : O_WRONLY;
+    return mode | f->flags;
+  case F_SETFL:
+    f->flags = arg & O_NONBLOCK;
+    return 0;
+  }
+  return -1;
+}
+
+int
+sys_poll(void)
+{
+  struct pollfd *fds;
+  int nfds, timeout;
+
+  if(argint(1, &nfds) < 0 || argint(2, &timeout) < 0 || nfds < 0 ||
+     argptr(0, (void*)&fds, nfds*sizeof(*fds)) < 0)
+    return -1;
+  return poll(fds, nfds, timeout);
+}
+
+int
+sys_mount(void)
+{
+  char path[MAXPATH];
+  int dev;
+  struct inode *ip;
+
+  if(argstr(0, path, sizeof(path)) < 0 || argint(1, &dev) < 0 || (ip = namei(path)) == 0)
+    return -1;
+  ilock(ip);
+  if(mount(ip, dev) < 0){
+    iunlockput(ip);
+    return -1;
+  }
+  iunlock(ip);
+  return 0;
+}
+
 int
 sys_close(void)
 {
@@ -90,7 +228,7 @@ sys_close(void)
   
   if(argfd(0, &fd, &f) < 0)
     return -1;
-  proc->ofile[fd] = 0;
+  fdclear(fd);
   fileclose(f);
   return 0;
 }
@@ -110,10 +248,10 @@ sys_fstat(void)
 int
 sys_link(void)
 {
-  char name[DIRSIZ], *new, *old;
+  char name[DIRSIZ], new[MAXPATH], old[MAXPATH];
   struct inode *dp, *ip;
 
-  if(argstr(0, &old) < 0 || argstr(1, &new) < 0)
+  if(argstr(0, old, sizeof(old)) < 0 || argstr(1, new, sizeof(new)) < 0)
     return -1;
   if((ip = namei(old)) == 0)
     return -1;
@@ -166,10 +304,10 @@ sys_unlink(void)
 {
   struct inode *ip, *dp;
   struct dirent de;
-  char name[DIRSIZ], *path;
+  char name[DIRSIZ], path[MAXPATH];
   uint off;
 
-  if(argstr(0, &path) < 0)
+  if(argstr(0, path, sizeof(path)) < 0)
     return -1;
   if((dp = nameiparent(path, name)) == 0)
     return -1;
@@ -254,16 +392,14 @@ create(char *path, short type, short major, short minor)
   return ip;
 }
 
-int
-sys_open(void)
+// Open path with omode and return a new fd for it.
+static int
+openfd(char *path, int omode)
 {
-  char *path;
-  int fd, omode;
+  int fd;
   struct file *f;
   struct inode *ip;
 
-  if(argstr(0, &path) < 0 || argint(1, &omode) < 0)
-    return -1;
   if(omode & O_CREATE){
     if((ip = create(path, T_FILE, 0, 0)) == 0)
       return -1;
@@ -290,16 +426,28 @@ sys_open(void)
   f->off = 0;
   f->readable = !(omode & O_WRONLY);
   f->writable = (omode & O_WRONLY) || (omode & O_RDWR);
+  f->flags = omode & O_NONBLOCK;
   return fd;
 }
 
+int
+sys_open(void)
+{
+  char path[MAXPATH];
+  int omode;
+
+  if(argstr(0, path, sizeof(path)) < 0 || argint(1, &omode) < 0)
+    return -1;
+  return openfd(path, omode);
+}
+
 int
 sys_mkdir(void)
 {
-  char *path;
+  char path[MAXPATH];
   struct inode *ip;
 
-  if(argstr(0, &path) < 0 || (ip = create(path, T_DIR, 0, 0)) == 0)
+  if(argstr(0, path, sizeof(path)) < 0 || (ip = create(path, T_DIR, 0, 0)) == 0)
     return -1;
   iunlockput(ip);
   return 0;
@@ -309,11 +457,11 @@ int
 sys_mknod(void)
 {
   struct inode *ip;
-  char *path;
+  char path[MAXPATH];
   int len;
   int major, minor;
   
-  if((len=argstr(0, &path)) < 0 ||
+  if((len=argstr(0, path, sizeof(path))) < 0 ||
      argint(1, &major) < 0 ||
      argint(2, &minor) < 0 ||
      (ip = create(path, T_DEV, major, minor)) == 0)
@@ -325,10 +473,10 @@ sys_mknod(void)
 int
 sys_chdir(void)
 {
-  char *path;
+  char path[MAXPATH];
   struct inode *ip;
 
-  if(argstr(0, &path) < 0 || (ip = namei(path)) == 0)
+  if(argstr(0, path, sizeof(path)) < 0 || (ip = namei(path)) == 0)
     return -1;
   ilock(ip);
   if(ip->type != T_DIR){
@@ -344,27 +492,38 @@ sys_chdir(void)
 int
 sys_exec(void)
 {
-  char *path, *argv[MAXARG];
-  int i;
+  char path[MAXPATH], *argv[MAXARG], *page, *s;
+  int i, n, r;
   uint uargv, uarg;
 
-  if(argstr(0, &path) < 0 || argint(1, (int*)&uargv) < 0){
+  if(argstr(0, path, sizeof(path)) < 0 || argint(1, (int*)&uargv) < 0){
     return -1;
   }
+  // Copy the argument strings into one page; they have to fit
+  // on the new program's one-page stack anyway.
+  if((page = kalloc()) == 0)
+    return -1;
   memset(argv, 0, sizeof(argv));
+  r = -1;
+  s = page;
   for(i=0;; i++){
     if(i >= NELEM(argv))
-      return -1;
+      goto out;
     if(fetchint(proc, uargv+4*i, (int*)&uarg) < 0)
-      return -1;
+      goto out;
     if(uarg == 0){
       argv[i] = 0;
       break;
     }
-    if(fetchstr(proc, uarg, &argv[i]) < 0)
-      return -1;
+    if((n = fetchstr(proc, uarg, s, page + PGSIZE - s)) < 0)
+      goto out;
+    argv[i] = s;
+    s += n + 1;
   }
-  return exec(path, argv);
+  r = exec(path, argv);
+out:
+  kfree(page);
+  return r;
 }
 
 int
@@ -381,7 +540,7 @@ sys_pipe(void)
   fd0 = -1;
   if((fd0 = fdalloc(rf)) < 0 || (fd1 = fdalloc(wf)) < 0){
     if(fd0 >= 0)
-      proc->ofile[fd0] = 0;
+      fdclear(fd0);
     fileclose(rf);
     fileclose(wf);
     return -1;
@@ -390,3 +549,90 @@ sys_pipe(void)
   fd[1] = fd1;
   return 0;
 }
+
+// Run one submission ring entry, checking its arguments
+// the way the matching system call would.
+static int
+ringop(struct sqe *e)
+{
+  struct file *f;
+  char path[MAXPATH];
+
+  if(e->op == RING_OPEN){
+    if(fetchstr(proc, e->addr, path, sizeof(path)) < 0)
+      return -1;
+    return openfd(path, e->n);
+  }
+  if(e->fd < 0 || e->fd >= proc->nofile || (f = proc->ofile[e->fd]) == 0)
+    return -1;
+  switch(e->op){
+  case RING_READ:
+  case RING_WRITE:
+    if(checkuptr(e->addr, e->n, e->op == RING_READ) < 0)
+      return -1;
+    if(e->op == RING_READ)
+      return fileread(f, (char*)e->addr, e->n);
+    return filewrite(f, (char*)e->addr, e->n);
+  case RING_CLOSE:
+    fdclear(e->fd);
+    fileclose(f);
+    return 0;
+  }
+  return -1;
+}
+
+// Run the submissions queued at entry, in order, for the cost of
+// one trap.  The process can keep queueing meanwhile, so stop
+// after RING_ENTRIES or if it is killed.  Returns the number run.
+int
+sys_ringenter(void)
+{
+  struct ring *r;
+  struct sqe e;
+  struct cqe *c;
+  uint tail;
+  int n;
+
+  if((r = proc->ring) == 0)
+    return -1;
+  tail = r->sqtail;
+  for(n = 0; n < RING_ENTRIES && r->sqhead != tail && !proc->killed; n++){
+    if(r->cqtail - r->cqhead >= RING_ENTRIES)
+      break;
+    // Copy the entry so the process cannot change it under us.
+    __sync_synchronize();
+    e = r->sq[r->sqhead % RING_ENTRIES];
+    r->sqhead++;
+    c = &r->cq[r->cqtail % RING_ENTRIES];
+    c->data = e.data;
+    c->res = ringop(&e);
+    __sync_synchronize();
+    r->cqtail++;
+  }
+  return n;
+}
+
+int
+sys_mmap(void)
+{
+  struct file *f;
+  int len, prot, flags, off;
+
+  // Argument 0, an address hint, is ignored.
+  if(argint(1, &len) < 0 || argint(2, &prot) < 0 || argint(3, &flags) < 0 ||
+     argfd(4, 0, &f) < 0 || argint(5, &off) < 0)
+    return -1;
+  if(len <= 0 || off < 0)
+    return -1;
+  return mmap(f, len, prot, flags, off);
+}
+
+int
+sys_munmap(void)
+{
+  int addr, len;
+
+  if(argint(0, &addr) < 0 || argint(1, &len) < 0)
+    return -1;
+  return munmap(addr, len);
+}
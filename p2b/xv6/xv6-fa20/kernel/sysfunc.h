@@ -27,5 +27,31 @@ int sys_uptime(void);
 int sys_getpri(void);
 int sys_setpri(void);
 int sys_getpinfo(void);
+int sys_getsysstat(void);
+int sys_mappinfo(void);
+int sys_profctl(void);
+int sys_profread(void);
+int sys_tracectl(void);
+int sys_traceread(void);
+int sys_getrusage(void);
+int sys_ringsetup(void);
+int sys_ringenter(void);
+int sys_readv(void);
+int sys_writev(void);
+int sys_pread(void);
+int sys_pwrite(void);
+int sys_mmap(void);
+int sys_munmap(void);
+int sys_shmat(void);
+int sys_shmdt(void);
+int sys_clone(void);
+int sys_join(void);
+int sys_futexwait(void);
+int sys_futexwake(void);
+int sys_fadvise(void);
+int sys_fcntl(void);
+int sys_poll(void);
+int sys_dmesg(void);
+int sys_mount(void);
 
 #endif // _SYSFUNC_H_
@@ -5,6 +5,8 @@
 #include "mmu.h"
 #include "proc.h"
 #include "sysfunc.h"
+#include "prof.h"
+#include "trace.h"
 
 int
 sys_fork(void)
@@ -88,3 +90,170 @@ sys_uptime(void)
   release(&tickslock);
   return xticks;
 }
+
+// Copy per-syscall counts and latencies for a process
+// (or the whole system, pid 0) to user space.
+int
+sys_getsysstat(void)
+{
+  int pid;
+  struct sysstat *st;
+
+  if(argint(0, &pid) < 0 || argptr(1, (void*)&st, sizeof(*st)) < 0)
+    return -1;
+  return getsysstat(pid, st);
+}
+
+// Map the scheduler statistics page; returns its address.
+int
+sys_mappinfo(void)
+{
+  return mappinfo();
+}
+
+int
+sys_profctl(void)
+{
+  int cmd;
+
+  if(argint(0, &cmd) < 0)
+    return -1;
+  return profctl(cmd);
+}
+
+// Copy retained profiler samples to user space.
+int
+sys_profread(void)
+{
+  struct profsample *buf;
+  int n;
+
+  if(argint(1, &n) < 0 || n < 0)
+    return -1;
+  if(n > NCPU*NPROFSAMPLE)
+    n = NCPU*NPROFSAMPLE;
+  if(argptr(0, (void*)&buf, n*sizeof(*buf)) < 0)
+    return -1;
+  return profread(buf, n);
+}
+
+int
+sys_tracectl(void)
+{
+  int cmd;
+
+  if(argint(0, &cmd) < 0)
+    return -1;
+  return tracectl(cmd);
+}
+
+// Copy retained trace events to user space.
+int
+sys_traceread(void)
+{
+  struct traceev *buf;
+  int n;
+
+  if(argint(1, &n) < 0 || n < 0)
+    return -1;
+  if(n > NCPU*NTRACEEV)
+    n = NCPU*NTRACEEV;
+  if(argptr(0, (void*)&buf, n*sizeof(*buf)) < 0)
+    return -1;
+  return traceread(buf, n);
+}
+
+int
+sys_getrusage(void)
+{
+  int who;
+  struct rusage *ru;
+
+  if(argint(0, &who) < 0 || argptr(1, (void*)&ru, sizeof(*ru)) < 0)
+    return -1;
+  if(who == RUSAGE_SELF)
+    *ru = proc->ru;
+  else if(who == RUSAGE_CHILDREN)
+    *ru = proc->cru;
+  else
+    return -1;
+  return 0;
+}
+
+int
+sys_ringsetup(void)
+{
+  return ringsetup();
+}
+
+int
+sys_dmesg(void)
+{
+  char *buf;
+  int n;
+
+  if(argint(1, &n) < 0 || n < 0 || argptr(0, &buf, n) < 0)
+    return -1;
+  return klogread(buf, n);
+}
+
+int
+sys_clone(void)
+{
+  int fcn, arg1, arg2, stack;
+
+  if(argint(0, &fcn) < 0 || argint(1, &arg1) < 0 ||
+     argint(2, &arg2) < 0 || argint(3, &stack) < 0)
+    return -1;
+  return clone(fcn, arg1, arg2, stack);
+}
+
+int
+sys_join(void)
+{
+  uint *stack;
+
+  if(argptr(0, (void*)&stack, sizeof(*stack)) < 0)
+    return -1;
+  return join((uint)stack);
+}
+
+int
+sys_futexwait(void)
+{
+  int *addr, val;
+
+  if(argrdptr(0, (void*)&addr, sizeof(*addr)) < 0 || argint(1, &val) < 0)
+    return -1;
+  return futexwait(addr, val);
+}
+
+int
+sys_futexwake(void)
+{
+  int *addr;
+
+  if(argrdptr(0, (void*)&addr, sizeof(*addr)) < 0)
+    return -1;
+  return futexwake(addr);
+}
+
+int
+sys_shmat(void)
+{
+  int key, size;
+
+  if(argint(0, &key) < 0 || argint(1, &size) < 0 || size <= 0)
+    return -1;
+  return shmat(key, size);
+}
+
+int
+sys_shmdt(void)
+{
+  int addr;
+
+  if(argint(0, &addr) < 0)
+    return -1;
+  return shmdt(addr);
+}
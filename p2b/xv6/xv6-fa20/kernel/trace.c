@@ -0,0 +1,55 @@
+// Kernel event trace.
+//
+// Tracepoints call trace(), which appends a timestamped event to
+// this cpu's ring (see cpuring.c), so no lock is needed.
+// Once a ring fills, the oldest events are overwritten.  When
+// tracing is off a tracepoint costs one load and branch.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "x86.h"
+#include "proc.h"
+#include "trace.h"
+#include "cpuring.h"
+
+static struct traceev traceevs[NCPU][NTRACEEV];
+static struct cpuring tracering = {
+  (char*)traceevs, sizeof(struct traceev), NTRACEEV
+};
+
+void
+trace(int type, uint arg)
+{
+  struct traceev *e;
+
+  if(!tracering.on)
+    return;
+  pushcli();
+  if((e = cpuringput(&tracering)) != 0){
+    e->tsc = rdtsc();
+    e->type = type;
+    e->cpu = cpu - cpus;
+    e->pid = proc ? proc->pid : 0;
+    e->arg = arg;
+  }
+  popcli();
+}
+
+// Start, stop or reset tracing.
+// TRACE_STOP returns the number of events recorded,
+// including any that were overwritten.
+int
+tracectl(int cmd)
+{
+  return cpuringctl(&tracering, cmd);
+}
+
+// Copy up to max retained events, oldest first per cpu,
+// into dst.  Returns the number copied.
+int
+traceread(struct traceev *dst, int max)
+{
+  return cpuringread(&tracering, dst, max);
+}
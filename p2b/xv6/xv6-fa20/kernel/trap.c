@@ -10,6 +10,7 @@
 // Interrupt descriptor table (shared by all CPUs).
 struct gatedesc idt[256];
 extern uint vectors[];  // in vectors.S: array of 256 entry pointers
+extern void sysentry(void);  // in trapasm.S: SYSENTER entry point
 struct spinlock tickslock;
 uint ticks;
 
@@ -28,13 +29,24 @@ tvinit(void)
 void
 idtinit(void)
 {
+  uint edx;
+
   lidt(idt, sizeof(idt));
+
+  // Enable the SYSENTER fast system call path if this cpu has it.
+  // switchuvm points MSR_SYSENTER_ESP at each process's kernel stack.
+  cpuid(1, 0, 0, 0, &edx);
+  if(edx & CPUID_SEP){
+    wrmsr(MSR_SYSENTER_CS, SEG_KCODE<<3);
+    wrmsr(MSR_SYSENTER_EIP, (uint)sysentry);
+    cpu->sysenter = 1;
+  }
 }
 
 void
 trap(struct trapframe *tf)
 {
-  if(tf->trapno == T_SYSCALL){
+  if(tf->trapno == T_SYSCALL || tf->trapno == T_SYSENTER){
     if(proc->killed)
       exit();
     proc->tf = tf;
@@ -46,20 +58,30 @@ trap(struct trapframe *tf)
 
   switch(tf->trapno){
   case T_IRQ0 + IRQ_TIMER:
+    profsample(tf);
+    if(proc){
+      if((tf->cs&3) == DPL_USER)
+        proc->ru.utime++;
+      else
+        proc->ru.stime++;
+    }
     if(cpu->id == 0){
       acquire(&tickslock);
       ticks++;
       wakeup(&ticks);
       release(&tickslock);
+      pstatpublish();
     }
     lapiceoi();
     break;
   case T_IRQ0 + IRQ_IDE:
-    ideintr();
+    ideintr(0);
     lapiceoi();
     break;
-  case T_IRQ0 + IRQ_IDE+1:
-    // Bochs generates spurious IDE1 interrupts.
+  case T_IRQ0 + IRQ_IDE2:
+    // Bochs generates spurious IDE1 interrupts; ideintr ignores them.
+    ideintr(1);
+    lapiceoi();
     break;
   case T_IRQ0 + IRQ_KBD:
     kbdintr();
@@ -77,12 +99,30 @@ trap(struct trapframe *tf)
     break;
    
   default:
+    // Writes to copy-on-write pages fault in user mode and, with
+    // CR0.WP set, when the kernel writes to user memory.
+    if(tf->trapno == T_PGFLT && proc && (tf->err & FEC_WR) && cowfault(proc->pgdir, rcr2()) == 0){
+      proc->ru.minflt++;
+      break;
+    }
+    // A system call touching a mapped page not yet faulted in.
+    // vmafault() may sleep, so not while holding a spinlock.
+    if(tf->trapno == T_PGFLT && proc && (tf->cs&3) == 0 && cpu->ncli == 0 &&
+       vmafault(rcr2(), tf->err & FEC_WR) == 0){
+      proc->ru.minflt++;
+      break;
+    }
     if(proc == 0 || (tf->cs&3) == 0){
       // In kernel, it must be our mistake.
       cprintf("unexpected trap %d from cpu %d eip %x (cr2=0x%x)\n",
               tf->trapno, cpu->id, tf->eip, rcr2());
       panic("trap");
     }
+    if(tf->trapno == T_PGFLT){
+      proc->ru.minflt++;
+      if(vmafault(rcr2(), tf->err & FEC_WR) == 0)
+        break;
+    }
     // In user space, assume process misbehaved.
     cprintf("pid %d %s: trap %d err %d on cpu %d "
             "eip 0x%x addr 0x%x--kill proc\n",
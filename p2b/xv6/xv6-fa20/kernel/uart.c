@@ -12,16 +12,30 @@
 #include "x86.h"
 
 #define COM1    0x3f8
+#define UART_FIFO 16  // bytes the transmit FIFO takes at once
 
 static int uart;    // is there a uart?
+static int polled;  // write synchronously (after a panic)
+
+// Output waits here for the transmitter; uartintr() moves it
+// to the FIFO each time the FIFO empties.
+#define UART_TXBUF 4096
+static struct {
+  struct spinlock lock;
+  char buf[UART_TXBUF];
+  uint r;  // next to transmit
+  uint w;  // next free
+} tx;
 
 void
 uartinit(void)
 {
   char *p;
 
-  // Turn off the FIFO
-  outb(COM1+2, 0);
+  initlock(&tx.lock, "uart");
+
+  // Enable and clear the FIFOs, interrupting on every received byte.
+  outb(COM1+2, 0x07);
   
   // 9600 baud, 8 data bits, 1 stop bit, parity off.
   outb(COM1+3, 0x80);    // Unlock divisor
@@ -29,7 +43,7 @@ uartinit(void)
   outb(COM1+1, 0);
   outb(COM1+3, 0x03);    // Lock divisor, 8 data bits.
   outb(COM1+4, 0);
-  outb(COM1+1, 0x01);    // Enable receive interrupts.
+  outb(COM1+1, 0x03);    // Enable receive and transmit-empty interrupts.
 
   // If status is 0xFF, no serial port.
   if(inb(COM1+5) == 0xFF)
@@ -48,16 +62,62 @@ uartinit(void)
     uartputc(*p);
 }
 
-void
-uartputc(int c)
+// Wait for the transmitter to empty, as the 8250 code always did.
+static void
+uartwait(void)
 {
   int i;
 
-  if(!uart)
-    return;
   for(i = 0; i < 128 && !(inb(COM1+5) & 0x20); i++)
     microdelay(10);
-  outb(COM1+0, c);
+}
+
+// Refill the FIFO from tx if it is empty.  Caller holds tx.lock.
+static void
+uartstart(void)
+{
+  int i;
+
+  if(tx.r == tx.w || !(inb(COM1+5) & 0x20))
+    return;
+  for(i = 0; i < UART_FIFO && tx.r != tx.w; i++)
+    outb(COM1+0, tx.buf[tx.r++ % UART_TXBUF]);
+}
+
+// Queue c for output.  Only a full buffer, which the interrupt
+// cannot drain while this CPU holds tx.lock, makes the caller wait.
+void
+uartputc(int c)
+{
+  if(!uart)
+    return;
+  if(polled){
+    uartwait();
+    outb(COM1+0, c);
+    return;
+  }
+  acquire(&tx.lock);
+  while(tx.w == tx.r + UART_TXBUF){
+    uartwait();
+    uartstart();
+  }
+  tx.buf[tx.w++ % UART_TXBUF] = c;
+  uartstart();
+  release(&tx.lock);
+}
+
+// Write out whatever is queued and from now on write each
+// character synchronously, for panic() with interrupts off.
+void
+uartpolled(void)
+{
+  if(!uart || polled)
+    return;
+  polled = 1;
+  while(tx.r != tx.w){
+    uartwait();
+    outb(COM1+0, tx.buf[tx.r++ % UART_TXBUF]);
+  }
 }
 
 static int
@@ -70,8 +130,16 @@ uartgetc(void)
   return inb(COM1+0);
 }
 
+// Reading IIR acknowledges a transmit-empty interrupt; keep at
+// it until nothing is pending, or the edge-triggered IRQ line
+// stays high and no further interrupt arrives.
 void
 uartintr(void)
 {
-  consoleintr(uartgetc);
+  while(!(inb(COM1+2) & 0x01)){
+    consoleintr(uartgetc);
+    acquire(&tx.lock);
+    uartstart();
+    release(&tx.lock);
+  }
 }
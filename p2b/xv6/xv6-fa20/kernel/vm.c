@@ -9,14 +9,8 @@
 extern char data[];  // defined in data.S
 
 static pde_t *kpgdir;  // for use in scheduler()
-
-// Allocate one page table for the machine for the kernel address
-// space for scheduler processes.
-void
-kvmalloc(void)
-{
-  kpgdir = setupkvm();
-}
+static int pse;       // map the kernel with 4MB pages
+static int pge;       // mark kernel mappings global
 
 // Set up CPU's kernel segment descriptors.
 // Run once at boot time on each CPU.
@@ -56,6 +50,8 @@ walkpgdir(pde_t *pgdir, const void *va, int create)
   pte_t *pgtab;
 
   pde = &pgdir[PDX(va)];
+  if(*pde & PTE_PS)
+    panic("walkpgdir: large page");
   if(*pde & PTE_P){
     pgtab = (pte_t*)PTE_ADDR(*pde);
   } else {
@@ -130,21 +126,78 @@ static struct kmap {
   {(void*)0xFE000000, 0,               PTE_W},  // device mappings
 };
 
-// Set up kernel part of a page table.
+// Like mappages, but use a 4MB page for each PTSIZE-aligned
+// chunk if the cpu supports them.
+static int
+kmappages(pde_t *pgdir, void *la, uint size, uint pa, int perm)
+{
+  char *a;
+  uint n;
+
+  a = la;
+  while(size > 0){
+    if(pse && (uint)a % PTSIZE == 0 && size >= PTSIZE){
+      pgdir[PDX(a)] = pa | perm | PTE_P | PTE_PS;
+      n = PTSIZE;
+    } else {
+      if(mappages(pgdir, a, PGSIZE, pa, perm) < 0)
+        return -1;
+      n = PGSIZE;
+    }
+    a += n;
+    pa += n;
+    size -= n;
+  }
+  return 0;
+}
+
+// Build kpgdir, which doubles as the template for the kernel
+// part of every process's page table.  The kernel mappings are
+// the same in every page table, so they are marked global and
+// survive the TLB flush on each cr3 load.
+void
+kvmalloc(void)
+{
+  struct kmap *k;
+  uint edx;
+
+  cpuid(1, 0, 0, 0, &edx);
+  pse = (edx & CPUID_PSE) != 0;
+  pge = (edx & CPUID_PGE) != 0;
+  if((kpgdir = (pde_t*)kalloc()) == 0)
+    panic("kvmalloc");
+  memset(kpgdir, 0, PGSIZE);
+  for(k = kmap; k < &kmap[NELEM(kmap)]; k++)
+    if(kmappages(kpgdir, k->p, k->e - k->p, (uint)k->p, k->perm | (pge ? PTE_G : 0)) < 0)
+      panic("kvmalloc");
+}
+
+// Set up kernel part of a page table by copying kpgdir.
+// Large-page entries are shared as is; the page tables under
+// the rest (the low 4MB, which user memory shares) are copied.
 pde_t*
 setupkvm(void)
 {
   pde_t *pgdir;
-  struct kmap *k;
+  pte_t *pgtab;
+  uint i;
 
   if((pgdir = (pde_t*)kalloc()) == 0)
     return 0;
-  memset(pgdir, 0, PGSIZE);
-  k = kmap;
-  for(k = kmap; k < &kmap[NELEM(kmap)]; k++)
-    if(mappages(pgdir, k->p, k->e - k->p, (uint)k->p, k->perm) < 0)
+  memmove(pgdir, kpgdir, PGSIZE);
+  for(i = 0; i < NPDENTRIES; i++){
+    if((pgdir[i] & PTE_P) == 0 || (pgdir[i] & PTE_PS))
+      continue;
+    if((pgtab = (pte_t*)kalloc()) == 0){
+      for(; i < NPDENTRIES; i++)
+        if(!(pgdir[i] & PTE_PS))
+          pgdir[i] = 0;
+      freevm(pgdir);
       return 0;
-
+    }
+    memmove(pgtab, (char*)PTE_ADDR(kpgdir[i]), PGSIZE);
+    pgdir[i] = PADDR(pgtab) | PTE_FLAGS(kpgdir[i]);
+  }
   return pgdir;
 }
 
@@ -154,9 +207,13 @@ vmenable(void)
 {
   uint cr0;
 
+  if(pse)
+    lcr4(rcr4() | CR4_PSE);
+  if(pge)
+    lcr4(rcr4() | CR4_PGE);
   switchkvm(); // load kpgdir into cr3
   cr0 = rcr0();
-  cr0 |= CR0_PG;
+  cr0 |= CR0_PG | CR0_WP;  // WP: kernel writes fault on copy-on-write pages
   lcr0(cr0);
 }
 
@@ -178,6 +235,8 @@ switchuvm(struct proc *p)
   cpu->ts.ss0 = SEG_KDATA << 3;
   cpu->ts.esp0 = (uint)proc->kstack + KSTACKSIZE;
   ltr(SEG_TSS << 3);
+  if(cpu->sysenter)
+    wrmsr(MSR_SYSENTER_ESP, (uint)proc->kstack + KSTACKSIZE);
   if(p->pgdir == 0)
     panic("switchuvm: no pgdir");
   lcr3(PADDR(p->pgdir));  // switch to new address space
@@ -288,12 +347,31 @@ freevm(pde_t *pgdir)
     panic("freevm: no pgdir");
   deallocuvm(pgdir, USERTOP, 0);
   for(i = 0; i < NPDENTRIES; i++){
-    if(pgdir[i] & PTE_P)
+    if((pgdir[i] & PTE_P) && !(pgdir[i] & PTE_PS))
       kfree((char*)PTE_ADDR(pgdir[i]));
   }
   kfree((char*)pgdir);
 }
 
+// Drop a reference to pgdir, which threads made by clone()
+// share, freeing it and its user memory with the last.
+void
+vmput(pde_t *pgdir)
+{
+  if(!kdrop((char*)pgdir))
+    freevm(pgdir);
+}
+
+// Is pgdir shared by threads made by clone()?  Their mappings
+// can then only be added to: a cpu running another of them could
+// keep a stale TLB entry for a removed one, and there is no
+// cross-cpu TLB shootdown.
+int
+vmshared(pde_t *pgdir)
+{
+  return krefs((char*)pgdir) > 1;
+}
+
 // Given a parent process's page table, create a copy
 // of it for a child.
 pde_t*
@@ -312,6 +390,10 @@ copyuvm(pde_t *pgdir, uint sz)
     if(!(*pte & PTE_P))
       panic("copyuvm: page not present");
     pa = PTE_ADDR(*pte);
+    // A page still shared copy-on-write is shared with the
+    // child too; if that fails, the child gets a private copy.
+    if((*pte & PTE_COW) && mapupage(d, i, (char*)pa, PTE_COW) == 0)
+      continue;
     if((mem = kalloc()) == 0)
       goto bad;
     memmove(mem, (char*)pa, PGSIZE);
@@ -354,6 +436,13 @@ copyout(pde_t *pgdir, uint va, void *p, uint len)
     pa0 = uva2ka(pgdir, (char*)va0);
     if(pa0 == 0)
       return -1;
+    // Writing through pa0 skips the page protections, so break
+    // copy-on-write sharing first.
+    if(!(*walkpgdir(pgdir, (char*)va0, 0) & PTE_W)){
+      if(cowfault(pgdir, va0) < 0)
+        return -1;
+      pa0 = uva2ka(pgdir, (char*)va0);
+    }
     n = PGSIZE - (va - va0);
     if(n > len)
       n = len;
@@ -364,3 +453,89 @@ copyout(pde_t *pgdir, uint va, void *p, uint len)
   }
   return 0;
 }
+
+// Return the physical page mapped at user address va in pgdir,
+// or 0 if there is none.  If dirtyp is not 0, set *dirtyp to
+// whether the page has been written through this mapping.
+char*
+uvmpage(pde_t *pgdir, uint va, int *dirtyp)
+{
+  pte_t *pte;
+
+  if((pte = walkpgdir(pgdir, (void*)va, 0)) == 0 || (*pte & PTE_P) == 0)
+    return 0;
+  if(dirtyp)
+    *dirtyp = (*pte & PTE_D) != 0;
+  return (char*)PTE_ADDR(*pte);
+}
+
+// Map the physical page pa at user address va in pgdir with
+// permissions perm (PTE_U is added), taking a reference on pa.
+// The page is shared, not copied: freevm() drops the reference.
+int
+mapupage(pde_t *pgdir, uint va, char *pa, int perm)
+{
+  if(va % PGSIZE || va >= USERTOP)
+    panic("mapupage");
+  if(mappages(pgdir, (void*)va, PGSIZE, PADDR(pa), perm|PTE_U) < 0)
+    return -1;
+  kref(pa);
+  return 0;
+}
+
+// Make the page at user address va in pgdir read-only and
+// copy-on-write, and return it, or 0 if there is none.
+char*
+uvmcow(pde_t *pgdir, uint va)
+{
+  pte_t *pte;
+
+  if((pte = walkpgdir(pgdir, (void*)va, 0)) == 0 || (*pte & PTE_P) == 0)
+    return 0;
+  *pte = (*pte & ~PTE_W) | PTE_COW;
+  return (char*)PTE_ADDR(*pte);
+}
+
+// Give pgdir its own copy of each copy-on-write page below sz,
+// before threads start sharing it: a copy made later would leave
+// the old page in other cpus' TLBs.  Returns 0, or -1 if out of
+// memory.
+int
+uvmunshare(pde_t *pgdir, uint sz)
+{
+  pte_t *pte;
+  uint va;
+
+  for(va = 0; va < sz; va += PGSIZE){
+    pte = walkpgdir(pgdir, (void*)va, 0);
+    if(pte && (*pte & PTE_COW) && cowfault(pgdir, va) < 0)
+      return -1;
+  }
+  return 0;
+}
+
+// Handle a write fault at user address va in pgdir: if the page
+// is copy-on-write, give pgdir its own writable copy.  Returns 0
+// on success, -1 if va is not copy-on-write.  Threads never share
+// a pgdir with copy-on-write pages (see uvmunshare()), so the
+// local TLB is the only one to flush.
+int
+cowfault(pde_t *pgdir, uint va)
+{
+  pte_t *pte;
+  char *mem, *pa;
+
+  if(va >= USERTOP)
+    return -1;
+  pte = walkpgdir(pgdir, (void*)va, 0);
+  if(pte == 0 || (*pte & (PTE_P|PTE_COW)) != (PTE_P|PTE_COW))
+    return -1;
+  if((mem = kalloc()) == 0)
+    return -1;
+  pa = (char*)PTE_ADDR(*pte);
+  memmove(mem, pa, PGSIZE);
+  *pte = PADDR(mem) | (PTE_FLAGS(*pte) & ~PTE_COW) | PTE_W;
+  invlpg(PGROUNDDOWN(va));
+  kfree(pa);
+  return 0;
+}
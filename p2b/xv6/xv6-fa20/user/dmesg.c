@@ -0,0 +1,22 @@
+// Print the kernel log: what cprintf() has written, oldest
+// first, as far back as the per-CPU log rings reach.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+
+static char buf[NCPU*KLOGSIZE];
+
+int
+main(int argc, char *argv[])
+{
+  int n;
+
+  if((n = dmesg(buf, sizeof(buf))) < 0){
+    printf(2, "dmesg: failed\n");
+    exit();
+  }
+  write(1, buf, n);
+  exit();
+}
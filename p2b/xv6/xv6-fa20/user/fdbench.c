@@ -0,0 +1,45 @@
+// Measure dup() latency as the fd table fills.
+//
+//   fdbench [descriptors]
+//
+// Dups stdin until the given number of descriptors (default
+// 1000) are open, printing the average cycles per dup for each
+// block of 128, then closes them all.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "x86.h"
+
+#define BLOCK 128
+
+int
+main(int argc, char *argv[])
+{
+  int n, fd, i, last;
+  uint64 t0;
+
+  n = argc > 1 ? atoi(argv[1]) : 1000;
+  last = 2;
+  printf(1, "fds\tcycles/dup\n");
+  while(last < n - 1){
+    t0 = rdtsc();
+    for(i = 0; i < BLOCK && last < n - 1; i++){
+      if((fd = dup(0)) < 0){
+        printf(2, "fdbench: dup failed with %d fds open\n", last + 1);
+        goto out;
+      }
+      if(fd != last + 1){
+        printf(2, "fdbench: dup returned %d, want %d\n", fd, last + 1);
+        goto out;
+      }
+      last = fd;
+    }
+    printf(1, "%d\t%d\n", last + 1, (uint)(rdtsc() - t0) / i);
+  }
+
+out:
+  for(fd = 3; fd <= last; fd++)
+    close(fd);
+  exit();
+}
@@ -3,6 +3,7 @@
 #include "types.h"
 #include "stat.h"
 #include "user.h"
+#include "fcntl.h"
 
 char buf[1024];
 int match(char*, char*);
@@ -56,6 +57,7 @@ main(int argc, char *argv[])
       printf(1, "grep: cannot open %s\n", argv[i]);
       exit();
     }
+    fadvise(fd, 0, 0, FADV_SEQUENTIAL);  // stream it through the cache
     grep(pattern, fd);
     close(fd);
   }
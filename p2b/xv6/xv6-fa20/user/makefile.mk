@@ -2,18 +2,33 @@
 # user programs
 USER_PROGS := \
 	cat\
+	dmesg\
 	echo\
+	fdbench\
 	forktest\
 	grep\
 	init\
 	kill\
 	ln\
 	ls\
+	mallocbench\
 	mkdir\
+	mmapbench\
+	mount\
+	nullcall\
+	parsum\
+	pingpong\
+	pollmux\
+	profile\
+	ps\
+	ringbench\
 	rm\
 	sh\
+	shmbench\
 	stressfs\
+	sysstat\
 	tester\
+	trace\
 	usertests\
 	wc\
 	zombie
@@ -25,7 +40,8 @@ USER_LIBS := \
 	ulib.o\
 	usys.o\
 	printf.o\
-	umalloc.o
+	umalloc.o\
+	uthread.o
 
 USER_LIBS := $(addprefix user/, $(USER_LIBS))
 
@@ -0,0 +1,73 @@
+// Measure malloc/free throughput and heap overhead.
+//
+//   mallocbench [log2 operations]
+//
+// Randomly allocates and frees blocks in a table of slots,
+// mostly small with an occasional large one, then reports
+// cycles per operation and how much of the heap grown with
+// sbrk was live at the peak.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "x86.h"
+
+#define NSLOT 512
+
+static char *slot[NSLOT];
+static uint slotsize[NSLOT];
+static uint seed = 1;
+
+static uint
+rand(void)
+{
+  seed = seed * 1103515245 + 12345;
+  return seed >> 8;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int shift, i, s;
+  uint live, peak, size, start;
+  uint64 t0, cycles;
+
+  shift = argc > 1 ? atoi(argv[1]) : 16;
+  if(shift < 0 || shift > 24){
+    printf(2, "usage: mallocbench [log2 operations, at most 24]\n");
+    exit();
+  }
+
+  start = (uint)sbrk(0);
+  live = peak = 0;
+  t0 = rdtsc();
+  for(i = 0; i < (1 << shift); i++){
+    s = rand() % NSLOT;
+    if(slot[s]){
+      free(slot[s]);
+      live -= slotsize[s];
+      slot[s] = 0;
+      continue;
+    }
+    if(rand() % 64 == 0)
+      size = 2048 + rand() % 8192;
+    else
+      size = 1 + rand() % 200;
+    if((slot[s] = malloc(size)) == 0){
+      printf(2, "mallocbench: out of memory after %d operations\n", i);
+      exit();
+    }
+    slot[s][0] = slot[s][size-1] = 1;
+    slotsize[s] = size;
+    live += size;
+    if(live > peak)
+      peak = live;
+  }
+  cycles = rdtsc() - t0;
+
+  printf(1, "%d ops: %d cycles/op\n", 1 << shift, (uint)(cycles >> shift));
+  size = (uint)sbrk(0) - start;
+  printf(1, "peak live %d bytes, heap grew %d bytes (%d%% live)\n",
+         peak, size, size ? (uint)(peak / (size / 100 + 1)) : 0);
+  exit();
+}
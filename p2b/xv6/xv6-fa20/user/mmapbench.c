@@ -0,0 +1,58 @@
+// Compare scanning a file with read() against mmap().
+//
+//   mmapbench [file]
+//
+// Sums the bytes of the file (default /usertests) both ways,
+// checks the sums agree and prints the cycles each took.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+#include "mman.h"
+#include "x86.h"
+
+static char buf[512];
+
+int
+main(int argc, char *argv[])
+{
+  char *path, *p;
+  int fd, n, i;
+  uint rsum, msum;
+  uint64 t0, rcyc, mcyc;
+  struct stat st;
+
+  path = argc > 1 ? argv[1] : "/usertests";
+  if((fd = open(path, O_RDONLY)) < 0 || fstat(fd, &st) < 0){
+    printf(2, "mmapbench: cannot open %s\n", path);
+    exit();
+  }
+
+  rsum = 0;
+  t0 = rdtsc();
+  while((n = read(fd, buf, sizeof(buf))) > 0)
+    for(i = 0; i < n; i++)
+      rsum += (uchar)buf[i];
+  rcyc = rdtsc() - t0;
+
+  msum = 0;
+  t0 = rdtsc();
+  if((p = mmap(0, st.size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED){
+    printf(2, "mmapbench: mmap failed\n");
+    exit();
+  }
+  for(i = 0; i < st.size; i++)
+    msum += (uchar)p[i];
+  munmap(p, st.size);
+  mcyc = rdtsc() - t0;
+  close(fd);
+
+  if(rsum != msum){
+    printf(2, "mmapbench: sums differ: read %x, mmap %x\n", rsum, msum);
+    exit();
+  }
+  printf(1, "%s: %d bytes, read %d kcycles, mmap %d kcycles\n",
+         path, st.size, (uint)(rcyc >> 10), (uint)(mcyc >> 10));
+  exit();
+}
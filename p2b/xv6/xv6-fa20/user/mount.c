@@ -0,0 +1,18 @@
+// Mount the file system on block device dev over directory dir.
+// Devices 0-3 are the IDE drives and 4 the RAM disk.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+int
+main(int argc, char *argv[])
+{
+  if(argc != 3){
+    printf(2, "Usage: mount dir dev\n");
+    exit();
+  }
+  if(mount(argv[1], atoi(argv[2])) < 0)
+    printf(2, "mount %s %s: failed\n", argv[1], argv[2]);
+  exit();
+}
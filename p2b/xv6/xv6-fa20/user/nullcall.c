@@ -0,0 +1,45 @@
+// Compare null system call latency through INT and SYSENTER.
+//
+//   nullcall [log2 iterations]
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "x86.h"
+
+// Average rdtsc cycles per call of f over 2^shift calls.
+static uint
+bench(int (*f)(void), int shift)
+{
+  uint64 t0;
+  int i;
+
+  t0 = rdtsc();
+  for(i = 0; i < (1 << shift); i++)
+    f();
+  return (uint)((rdtsc() - t0) >> shift);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int shift, pid;
+  uint slow, fast;
+
+  shift = argc > 1 ? atoi(argv[1]) : 16;
+  if(shift < 0 || shift > 24){
+    printf(2, "usage: nullcall [log2 iterations, at most 24]\n");
+    exit();
+  }
+  pid = getpid();
+  if(getpid_fast() != pid){
+    printf(2, "nullcall: getpid_fast returned the wrong pid\n");
+    exit();
+  }
+  bench(getpid, 8);  // warm up
+  slow = bench(getpid, shift);
+  fast = bench(getpid_fast, shift);
+  printf(1, "getpid: int %d cycles, sysenter %d cycles (%d calls)\n",
+         slow, fast, 1 << shift);
+  exit();
+}
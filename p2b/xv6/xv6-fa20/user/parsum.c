@@ -0,0 +1,78 @@
+// Sum a shared array with 1..N threads made by thread_create()
+// and report cycles per run.
+//
+//   parsum [max threads]
+//
+// Each thread sums its slice privately and adds the result to the
+// total under a mutex; a spin-locked counter checks that every
+// thread got through.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "x86.h"
+
+#define N      (32*1024)
+#define PASSES 64
+
+static int *a;
+static int total, done;
+static mutex_t totallock;
+static lock_t donelock;
+
+static void
+worker(void *lo, void *hi)
+{
+  int i, p, sum;
+
+  sum = 0;
+  for(p = 0; p < PASSES; p++)
+    for(i = (int)lo; i < (int)hi; i++)
+      sum += a[i];
+  mutex_lock(&totallock);
+  total += sum;
+  mutex_unlock(&totallock);
+  lock_acquire(&donelock);
+  done++;
+  lock_release(&donelock);
+  exit();
+}
+
+int
+main(int argc, char *argv[])
+{
+  int i, n, nthread, want;
+  uint64 t0;
+
+  nthread = argc > 1 ? atoi(argv[1]) : 4;
+  if((a = malloc(N * sizeof(a[0]))) == 0){
+    printf(2, "parsum: out of memory\n");
+    exit();
+  }
+  for(i = 0; i < N; i++)
+    a[i] = i & 0xff;
+  want = 0;
+  for(i = 0; i < N; i++)
+    want += a[i];
+  want *= PASSES;
+  mutex_init(&totallock);
+  lock_init(&donelock);
+
+  printf(1, "threads\tcycles\n");
+  for(n = 1; n <= nthread; n++){
+    total = done = 0;
+    t0 = rdtsc();
+    for(i = 0; i < n; i++)
+      if(thread_create(worker, (void*)(N*i/n), (void*)(N*(i+1)/n)) < 0){
+        printf(2, "parsum: thread_create failed\n");
+        exit();
+      }
+    for(i = 0; i < n; i++)
+      thread_join();
+    t0 = rdtsc() - t0;
+    printf(1, "%d\t%d\n", n, (uint)t0);
+    if(total != want || done != n)
+      printf(2, "parsum: got %d from %d threads, want %d\n", total, done, want);
+  }
+  exit();
+}
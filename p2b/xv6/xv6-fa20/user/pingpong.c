@@ -0,0 +1,54 @@
+// Measure context switch cost by bouncing a byte between two
+// processes over a pair of pipes.
+//
+//   pingpong [log2 round trips]
+//
+// Each round trip is two switches, one into each process.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "x86.h"
+
+int
+main(int argc, char *argv[])
+{
+  int shift, i, ping[2], pong[2];
+  char c;
+  uint64 t0;
+
+  shift = argc > 1 ? atoi(argv[1]) : 12;
+  if(shift < 0 || shift > 20){
+    printf(2, "usage: pingpong [log2 round trips, at most 20]\n");
+    exit();
+  }
+  if(pipe(ping) < 0 || pipe(pong) < 0){
+    printf(2, "pingpong: pipe failed\n");
+    exit();
+  }
+
+  if(fork() == 0){
+    close(ping[1]);
+    close(pong[0]);
+    while(read(ping[0], &c, 1) == 1)
+      write(pong[1], &c, 1);
+    exit();
+  }
+  close(ping[0]);
+  close(pong[1]);
+
+  c = 0;
+  t0 = rdtsc();
+  for(i = 0; i < (1 << shift); i++){
+    write(ping[1], &c, 1);
+    if(read(pong[0], &c, 1) != 1){
+      printf(2, "pingpong: child went away\n");
+      break;
+    }
+  }
+  printf(1, "pingpong: %d cycles per round trip (%d trips)\n",
+         (uint)((rdtsc() - t0) >> shift), i);
+  close(ping[1]);
+  wait();
+  exit();
+}
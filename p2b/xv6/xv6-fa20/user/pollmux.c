@@ -0,0 +1,85 @@
+// Read from many pipes in one process with poll().
+//
+//   pollmux [writers [messages each]]
+//
+// Each child writes its messages to its own pipe, sleeping a
+// different number of ticks between them.  The parent drains
+// whichever pipes are ready through non-blocking reads until
+// every writer has hung up, then reports what it saw.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+
+#define MAXW 16
+
+static struct pollfd fds[MAXW];
+
+int
+main(int argc, char *argv[])
+{
+  int nw, nmsg, i, j, n, open, polls, bytes[MAXW], p[2];
+  char buf[64];
+
+  nw = argc > 1 ? atoi(argv[1]) : 4;
+  nmsg = argc > 2 ? atoi(argv[2]) : 8;
+  if(nw < 1 || nw > MAXW){
+    printf(2, "pollmux: 1 to %d writers\n", MAXW);
+    exit();
+  }
+
+  for(i = 0; i < nw; i++){
+    if(pipe(p) < 0){
+      printf(2, "pollmux: pipe failed\n");
+      exit();
+    }
+    if(fork() == 0){
+      close(p[0]);
+      for(j = 0; j < nmsg; j++){
+        sleep(i + 1);
+        write(p[1], "message\n", 8);
+      }
+      exit();
+    }
+    close(p[1]);
+    fcntl(p[0], F_SETFL, O_NONBLOCK);
+    fds[i].fd = p[0];
+    fds[i].events = POLLIN;
+    bytes[i] = 0;
+  }
+
+  polls = 0;
+  for(open = nw; open > 0; ){
+    if((n = poll(fds, nw, 100)) < 0){
+      printf(2, "pollmux: poll failed\n");
+      exit();
+    }
+    polls++;
+    if(n == 0){
+      printf(2, "pollmux: timed out with %d writers left\n", open);
+      break;
+    }
+    for(i = 0; i < nw; i++){
+      if(fds[i].revents & POLLIN){
+        // Non-blocking: drain what is there, stop at -1.
+        while((n = read(fds[i].fd, buf, sizeof(buf))) > 0)
+          bytes[i] += n;
+        if(n == 0)
+          fds[i].revents |= POLLHUP;
+      }
+      if(fds[i].revents & POLLHUP){
+        close(fds[i].fd);
+        fds[i].fd = -1;
+        open--;
+      }
+    }
+  }
+  for(i = 0; i < nw; i++)
+    wait();
+
+  printf(1, "%d polls\n", polls);
+  for(i = 0; i < nw; i++)
+    printf(1, "writer %d: %d bytes\n", i, bytes[i]);
+  exit();
+}
@@ -2,14 +2,95 @@
 #include "stat.h"
 #include "user.h"
 
+// Output is buffered per fd.  Console output is flushed at the
+// end of every printf call; files and pipes only when the buffer
+// fills, on fflush(), and before close, fork, exec and exit.
+// Buffers are handed out to fds as they are first printed to;
+// once all NOBUF are in use, output to further fds is unbuffered.
+
+#define OBUFSIZE 512
+#define NOBUF    16  // fds with a buffer at once
+
+#define OB_UNSET 0  // buffer free
+#define OB_LINE  1  // console: flush after each printf
+#define OB_FULL  2  // file or pipe: flush when full
+
+struct obuf {
+  int mode;
+  int fd;
+  int n;
+  char buf[OBUFSIZE];
+};
+
+static struct obuf obuf[NOBUF];
+
+// Return fd's buffer, or 0 if it has none.  With alloc set,
+// give fd a free buffer if it has none and one is left.
+static struct obuf*
+getobuf(int fd, int alloc)
+{
+  struct obuf *b, *fb;
+  struct stat st;
+
+  fb = 0;
+  for(b = obuf; b < &obuf[NOBUF]; b++){
+    if(b->mode == OB_UNSET){
+      if(fb == 0)
+        fb = b;
+    } else if(b->fd == fd)
+      return b;
+  }
+  if(!alloc || fb == 0 || fd < 0)
+    return 0;
+  if(fstat(fd, &st) == 0 && st.type != T_DEV)
+    fb->mode = OB_FULL;
+  else
+    fb->mode = OB_LINE;
+  fb->fd = fd;
+  fb->n = 0;
+  return fb;
+}
+
 static void
-putc(int fd, char c)
+flushbuf(struct obuf *b)
 {
-  write(fd, &c, 1);
+  if(b->n > 0){
+    write(b->fd, b->buf, b->n);
+    b->n = 0;
+  }
 }
 
+// Write out fd's buffered output, or every fd's if fd < 0.
+void
+fflush(int fd)
+{
+  struct obuf *b;
+
+  if(fd < 0){
+    for(b = obuf; b < &obuf[NOBUF]; b++)
+      if(b->mode != OB_UNSET)
+        flushbuf(b);
+    return;
+  }
+  if((b = getobuf(fd, 0)) != 0)
+    flushbuf(b);
+}
+
+// Add c to fd's output, through b unless it is 0.
 static void
-printint(int fd, int xx, int base, int sgn)
+putc(struct obuf *b, int fd, char c)
+{
+  if(b == 0){
+    write(fd, &c, 1);
+    return;
+  }
+  if(b->n == OBUFSIZE)
+    flushbuf(b);
+  b->buf[b->n++] = c;
+}
+
+static void
+printint(struct obuf *b, int fd, int xx, int base, int sgn)
 {
   static char digits[] = "0123456789ABCDEF";
   char buf[16];
@@ -32,17 +113,20 @@ printint(int fd, int xx, int base, int sgn)
     buf[i++] = '-';
 
   while(--i >= 0)
-    putc(fd, buf[i]);
+    putc(b, fd, buf[i]);
 }
 
 // Print to the given fd. Only understands %d, %x, %p, %s.
 void
 printf(int fd, char *fmt, ...)
 {
+  struct obuf *b;
   char *s;
   int c, i, state;
   uint *ap;
 
+  b = getobuf(fd, 1);
+
   state = 0;
   ap = (uint*)(void*)&fmt + 1;
   for(i = 0; fmt[i]; i++){
@@ -51,14 +135,14 @@ printf(int fd, char *fmt, ...)
       if(c == '%'){
         state = '%';
       } else {
-        putc(fd, c);
+        putc(b, fd, c);
       }
     } else if(state == '%'){
       if(c == 'd'){
-        printint(fd, *ap, 10, 1);
+        printint(b, fd, *ap, 10, 1);
         ap++;
       } else if(c == 'x' || c == 'p'){
-        printint(fd, *ap, 16, 0);
+        printint(b, fd, *ap, 16, 0);
         ap++;
       } else if(c == 's'){
         s = (char*)*ap;
@@ -66,20 +150,58 @@ printf(int fd, char *fmt, ...)
         if(s == 0)
           s = "(null)";
         while(*s != 0){
-          putc(fd, *s);
+          putc(b, fd, *s);
           s++;
         }
       } else if(c == 'c'){
-        putc(fd, *ap);
+        putc(b, fd, *ap);
         ap++;
       } else if(c == '%'){
-        putc(fd, c);
+        putc(b, fd, c);
       } else {
         // Unknown % sequence.  Print it to draw attention.
-        putc(fd, '%');
-        putc(fd, c);
+        putc(b, fd, '%');
+        putc(b, fd, c);
       }
       state = 0;
     }
   }
+  if(b && b->mode == OB_LINE)
+    flushbuf(b);
+}
+
+int
+close(int fd)
+{
+  struct obuf *b;
+
+  if((b = getobuf(fd, 0)) != 0){
+    flushbuf(b);
+    b->mode = OB_UNSET;
+  }
+  return _close(fd);
+}
+
+int
+fork(void)
+{
+  fflush(-1);
+  return _fork();
+}
+
+int
+exec(char *path, char **argv)
+{
+  fflush(-1);
+  return _exec(path, argv);
+}
+
+// The buffers are not locked, so this must not race with
+// printf() in another thread: its output could be lost or
+// written twice.
+int
+exit(void)
+{
+  fflush(-1);
+  _exit();
 }
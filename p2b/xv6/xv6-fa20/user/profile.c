@@ -0,0 +1,324 @@
+// Sampling profiler front end.
+//
+//   profile cmd args...
+//
+// Runs cmd with clock-interrupt sampling on, then prints a flat
+// profile of where its time went and the hottest kernel
+// caller -> callee edges.  Kernel pcs are named from /kernel.sym,
+// which make installs; user pcs from cmd's own ELF symbol table.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+
+#define MAXSAMPLE (NCPU*NPROFSAMPLE)
+#define MAXEDGE   256
+#define TOPN      15
+
+// Just the ELF pieces needed to find the symbol table.
+struct elfhdr {
+  uint magic;
+  uchar elf[12];
+  ushort type, machine;
+  uint version, entry, phoff, shoff, flags;
+  ushort ehsize, phentsize, phnum, shentsize, shnum, shstrndx;
+};
+
+struct secthdr {
+  uint name, type, flags, addr, offset, size, link, info, align, entsize;
+};
+
+struct elfsym {
+  uint name, value, size;
+  uchar info, other;
+  ushort shndx;
+};
+
+#define ELF_MAGIC   0x464C457FU
+#define SHT_SYMTAB  2
+#define STT_FUNC    2
+
+struct sym {
+  uint addr;
+  char *name;
+  uint hits;
+};
+
+struct symtab {
+  struct sym *s;
+  int n;
+};
+
+struct edge {
+  int from, to;   // kernel symbol indices
+  uint hits;
+};
+
+static struct symtab ksyms, usyms;
+static struct profsample samples[MAXSAMPLE];
+static struct edge edges[MAXEDGE];
+static int nedge;
+
+// Read all of path into a malloc'd buffer.
+static char*
+readfile(char *path, uint *size)
+{
+  struct stat st;
+  char *buf;
+  int fd, n, off;
+
+  if((fd = open(path, O_RDONLY)) < 0)
+    return 0;
+  if(fstat(fd, &st) < 0 || (buf = malloc(st.size + 1)) == 0){
+    close(fd);
+    return 0;
+  }
+  for(off = 0; off < st.size; off += n)
+    if((n = read(fd, buf + off, st.size - off)) <= 0)
+      break;
+  close(fd);
+  buf[off] = 0;
+  *size = off;
+  return buf;
+}
+
+static void
+sortsyms(struct symtab *t)
+{
+  struct sym tmp;
+  int i, j;
+
+  for(i = 1; i < t->n; i++){
+    tmp = t->s[i];
+    for(j = i; j > 0 && t->s[j-1].addr > tmp.addr; j--)
+      t->s[j] = t->s[j-1];
+    t->s[j] = tmp;
+  }
+}
+
+// Parse "hexaddr name" lines as written by make into kernel.sym.
+static void
+loadkernel(struct symtab *t)
+{
+  char *buf, *p;
+  uint size, addr;
+  int n, c;
+
+  if((buf = readfile("/kernel.sym", &size)) == 0){
+    printf(2, "profile: no /kernel.sym, kernel pcs left raw\n");
+    return;
+  }
+  n = 0;
+  for(p = buf; *p; p++)
+    if(*p == '\n')
+      n++;
+  t->s = malloc(n * sizeof(struct sym));
+  t->n = 0;
+  for(p = buf; *p && t->n < n; ){
+    addr = 0;
+    for(; *p && *p != ' '; p++){
+      c = *p;
+      addr = addr*16 + (c >= 'a' ? c - 'a' + 10 : c - '0');
+    }
+    if(*p)
+      p++;
+    t->s[t->n].addr = addr;
+    t->s[t->n].name = p;
+    t->s[t->n].hits = 0;
+    t->n++;
+    while(*p && *p != '\n')
+      p++;
+    if(*p)
+      *p++ = 0;
+  }
+  sortsyms(t);
+}
+
+// Collect function symbols from the ELF file path.
+static void
+loaduser(struct symtab *t, char *path)
+{
+  struct elfhdr *eh;
+  struct secthdr *sh, *symsh;
+  struct elfsym *es;
+  char *buf, *strs;
+  uint size;
+  int i, n;
+
+  t->n = 0;
+  if((buf = readfile(path, &size)) == 0)
+    return;
+  eh = (struct elfhdr*)buf;
+  if(size < sizeof(*eh) || eh->magic != ELF_MAGIC ||
+     eh->shoff + eh->shnum*sizeof(*sh) > size)
+    return;
+  sh = (struct secthdr*)(buf + eh->shoff);
+  symsh = 0;
+  for(i = 0; i < eh->shnum; i++)
+    if(sh[i].type == SHT_SYMTAB)
+      symsh = &sh[i];
+  if(symsh == 0 || symsh->link >= eh->shnum)
+    return;
+  es = (struct elfsym*)(buf + symsh->offset);
+  strs = buf + sh[symsh->link].offset;
+  n = symsh->size / sizeof(*es);
+  t->s = malloc(n * sizeof(struct sym));
+  for(i = 0; i < n; i++){
+    if((es[i].info & 0xf) != STT_FUNC)
+      continue;
+    t->s[t->n].addr = es[i].value;
+    t->s[t->n].name = strs + es[i].name;
+    t->s[t->n].hits = 0;
+    t->n++;
+  }
+  sortsyms(t);
+}
+
+// Index of the symbol containing pc, or -1.
+static int
+lookup(struct symtab *t, uint pc)
+{
+  int lo, hi, mid;
+
+  if(t->n == 0 || pc < t->s[0].addr)
+    return -1;
+  lo = 0;
+  hi = t->n - 1;
+  while(lo < hi){
+    mid = (lo + hi + 1) / 2;
+    if(t->s[mid].addr <= pc)
+      lo = mid;
+    else
+      hi = mid - 1;
+  }
+  return lo;
+}
+
+static void
+addedge(int from, int to)
+{
+  int i;
+
+  if(from < 0 || to < 0)
+    return;
+  for(i = 0; i < nedge; i++)
+    if(edges[i].from == from && edges[i].to == to){
+      edges[i].hits++;
+      return;
+    }
+  if(nedge < MAXEDGE){
+    edges[nedge].from = from;
+    edges[nedge].to = to;
+    edges[nedge].hits = 1;
+    nedge++;
+  }
+}
+
+// Print the TOPN symbols of t with the most hits.
+static void
+flat(char *what, struct symtab *t, uint total)
+{
+  int j, best, printed;
+  uint last;
+
+  printf(1, "\n%s:\n  hits\t%%\tfunction\n", what);
+  printed = 0;
+  last = 0xffffffff;
+  while(printed < TOPN){
+    // largest hit count below the last one printed
+    best = -1;
+    for(j = 0; j < t->n; j++)
+      if(t->s[j].hits > 0 && t->s[j].hits < last &&
+         (best < 0 || t->s[j].hits > t->s[best].hits))
+        best = j;
+    if(best < 0)
+      break;
+    last = t->s[best].hits;
+    for(j = 0; j < t->n && printed < TOPN; j++)
+      if(t->s[j].hits == last){
+        printf(1, "  %d\t%d\t%s\n", last, last*100/total, t->s[j].name);
+        printed++;
+      }
+  }
+}
+
+static void
+printedges(void)
+{
+  struct edge tmp;
+  int i, j;
+
+  for(i = 1; i < nedge; i++){
+    tmp = edges[i];
+    for(j = i; j > 0 && edges[j-1].hits < tmp.hits; j--)
+      edges[j] = edges[j-1];
+    edges[j] = tmp;
+  }
+  printf(1, "\nkernel call edges:\n  hits\tcaller -> callee\n");
+  for(i = 0; i < nedge && i < TOPN; i++)
+    printf(1, "  %d\t%s -> %s\n", edges[i].hits,
+           ksyms.s[edges[i].from].name, ksyms.s[edges[i].to].name);
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct profsample *s;
+  int pid, taken, n, i, j, callee, caller;
+  uint kern, user, other, unknown;
+
+  if(argc < 2){
+    printf(2, "usage: profile cmd args...\n");
+    exit();
+  }
+  loadkernel(&ksyms);
+  loaduser(&usyms, argv[1]);
+
+  profctl(PROF_RESET);
+  profctl(PROF_START);
+  if((pid = fork()) == 0){
+    exec(argv[1], argv+1);
+    printf(2, "profile: exec %s failed\n", argv[1]);
+    exit();
+  }
+  wait();
+  taken = profctl(PROF_STOP);
+  n = profread(samples, MAXSAMPLE);
+
+  kern = user = other = unknown = 0;
+  for(i = 0; i < n; i++){
+    s = &samples[i];
+    if(s->kernel){
+      kern++;
+      if((callee = lookup(&ksyms, s->eip)) < 0){
+        unknown++;
+        continue;
+      }
+      ksyms.s[callee].hits++;
+      for(j = 0; j < PROFDEPTH && s->pcs[j]; j++){
+        caller = lookup(&ksyms, s->pcs[j]);
+        addedge(caller, callee);
+        callee = caller;
+      }
+    } else if(s->pid == pid){
+      user++;
+      if((callee = lookup(&usyms, s->eip)) < 0)
+        unknown++;
+      else
+        usyms.s[callee].hits++;
+    } else {
+      other++;
+    }
+  }
+
+  printf(1, "\nsamples: %d taken, %d kept: %d kernel, %d %s, "
+         "%d other user, %d unnamed\n",
+         taken, n, kern, user, argv[1], other, unknown);
+  if(n == 0)
+    exit();
+  flat("kernel", &ksyms, n);
+  flat(argv[1], &usyms, n);
+  printedges();
+  exit();
+}
@@ -0,0 +1,45 @@
+// List processes from the kernel's shared pstat snapshot.
+// After the one mappinfo() call, reading takes no syscalls.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "pstat.h"
+
+static char *states[] = {
+[UNUSED]    "unused",
+[EMBRYO]    "embryo",
+[SLEEPING]  "sleep ",
+[RUNNABLE]  "runble",
+[RUNNING]   "run   ",
+[ZOMBIE]    "zombie"
+};
+
+// Too big for the one-page user stack.
+static struct pstat st;
+
+int
+main(int argc, char *argv[])
+{
+  struct pstatpage *pg;
+  int i;
+
+  if((int)(pg = mappinfo()) < 0){
+    printf(2, "ps: mappinfo failed\n");
+    exit();
+  }
+  // The snapshot is refreshed every tick; wait for the first.
+  while(pg->seq == 0)
+    sleep(1);
+  readpinfo(pg, &st);
+
+  printf(1, "pid\tpri\tstate\tticks 3/2/1/0\n");
+  for(i = 0; i < NPROC; i++){
+    if(!st.inuse[i])
+      continue;
+    printf(1, "%d\t%d\t%s\t%d/%d/%d/%d\n", st.pid[i], st.priority[i],
+           states[st.state[i]], st.ticks[i][3], st.ticks[i][2],
+           st.ticks[i][1], st.ticks[i][0]);
+  }
+  exit();
+}
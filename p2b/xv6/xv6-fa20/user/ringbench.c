@@ -0,0 +1,91 @@
+// Compare reading a file with one read() trap per chunk
+// against batching the same reads through the submission ring.
+//
+//   ringbench [file [chunk]]
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+#include "x86.h"
+
+static char buf[512];
+
+// Cycles per op, without 64-bit division.
+static uint
+perop(uint64 cycles, int ops)
+{
+  if(ops == 0)
+    return 0;
+  return ((uint)(cycles >> 4) / ops) << 4;
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct ring *r;
+  struct sqe *e;
+  struct cqe *c;
+  char *file;
+  int fd, chunk, ops, total, done, n;
+  uint64 t0, plain, ring;
+
+  file = argc > 1 ? argv[1] : "README";
+  chunk = argc > 2 ? atoi(argv[2]) : 16;
+  if(chunk <= 0 || chunk > sizeof(buf)){
+    printf(2, "usage: ringbench [file [chunk <= %d]]\n", sizeof(buf));
+    exit();
+  }
+  if((r = ringsetup()) == (struct ring*)-1){
+    printf(2, "ringbench: ringsetup failed\n");
+    exit();
+  }
+
+  // One trap per read.
+  if((fd = open(file, O_RDONLY)) < 0){
+    printf(2, "ringbench: cannot open %s\n", file);
+    exit();
+  }
+  ops = total = 0;
+  t0 = rdtsc();
+  while((n = read(fd, buf, chunk)) > 0){
+    ops++;
+    total += n;
+  }
+  plain = rdtsc() - t0;
+  close(fd);
+
+  // A ring full of reads per trap.  Reads past EOF return 0.
+  fd = open(file, O_RDONLY);
+  ops = n = 0;
+  done = 0;
+  t0 = rdtsc();
+  while(!done){
+    while(r->sqtail - r->sqhead < RING_ENTRIES){
+      e = &r->sq[r->sqtail % RING_ENTRIES];
+      e->op = RING_READ;
+      e->fd = fd;
+      e->addr = (uint)buf;
+      e->n = chunk;
+      e->data = ops++;
+      r->sqtail++;
+    }
+    ringenter();
+    for(; r->cqhead != r->cqtail; r->cqhead++){
+      c = &r->cq[r->cqhead % RING_ENTRIES];
+      if(c->res <= 0)
+        done = 1;
+      else
+        n += c->res;
+    }
+  }
+  ring = rdtsc() - t0;
+  close(fd);
+
+  if(n != total)
+    printf(2, "ringbench: read %d bytes via ring, %d via read\n", n, total);
+  ops = (total + chunk - 1) / chunk;
+  printf(1, "%d reads of %d bytes: read() %d cycles/op, ring %d cycles/op\n",
+         ops, chunk, perop(plain, ops), perop(ring, ops));
+  exit();
+}
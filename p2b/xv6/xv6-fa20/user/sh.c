@@ -141,6 +141,26 @@ getcmd(char *buf, int nbuf)
   return 0;
 }
 
+// Run cmd, then report the time and I/O it used.
+void
+timecmd(char *cmd)
+{
+  struct rusage r0, r1;
+  int t0;
+
+  getrusage(RUSAGE_CHILDREN, &r0);
+  t0 = uptime();
+  if(fork1() == 0)
+    runcmd(parsecmd(cmd));
+  wait();
+  getrusage(RUSAGE_CHILDREN, &r1);
+  printf(2, "real %d user %d sys %d ticks; %d in %d out blocks; "
+         "%d vol %d invol switches\n", uptime() - t0,
+         r1.utime - r0.utime, r1.stime - r0.stime,
+         r1.inblock - r0.inblock, r1.oublock - r0.oublock,
+         r1.nvcsw - r0.nvcsw, r1.nivcsw - r0.nivcsw);
+}
+
 int
 main(void)
 {
@@ -165,6 +185,11 @@ main(void)
         printf(2, "cannot cd %s\n", buf+3);
       continue;
     }
+    if(buf[0] == 't' && buf[1] == 'i' && buf[2] == 'm' && buf[3] == 'e' &&
+       buf[4] == ' '){
+      timecmd(buf+5);
+      continue;
+    }
     if(fork1() == 0)
       runcmd(parsecmd(buf));
     wait();
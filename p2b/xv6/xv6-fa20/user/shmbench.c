@@ -0,0 +1,100 @@
+// Compare moving data between processes through a shared memory
+// segment against a pipe.
+//
+//   shmbench [KB to move]
+//
+// The shared memory run double-buffers through the two halves of
+// a segment; one-byte pipe messages only say which half is ready.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "x86.h"
+
+#define KEY   537
+#define CHUNK (32*1024)
+
+static char src[CHUNK], dst[CHUNK];
+
+static uint64
+shmrun(int nchunk)
+{
+  int full[2], empty[2], i;
+  char *seg, c;
+  uint64 t0;
+
+  if((seg = shmat(KEY, 2*CHUNK)) == (char*)-1){
+    printf(2, "shmbench: shmat failed\n");
+    exit();
+  }
+  pipe(full);
+  pipe(empty);
+  t0 = rdtsc();
+  if(fork() == 0){
+    // Producer: both halves start out empty.
+    for(i = 0; i < nchunk; i++){
+      if(i >= 2)
+        read(empty[0], &c, 1);
+      memmove(seg + (i%2)*CHUNK, src, CHUNK);
+      write(full[1], &c, 1);
+    }
+    exit();
+  }
+  for(i = 0; i < nchunk; i++){
+    read(full[0], &c, 1);
+    memmove(dst, seg + (i%2)*CHUNK, CHUNK);
+    write(empty[1], &c, 1);
+  }
+  wait();
+  t0 = rdtsc() - t0;
+  close(full[0]);
+  close(full[1]);
+  close(empty[0]);
+  close(empty[1]);
+  shmdt(seg);
+  return t0;
+}
+
+static uint64
+piperun(int nchunk)
+{
+  int p[2], i, n, m;
+  uint64 t0;
+
+  pipe(p);
+  t0 = rdtsc();
+  if(fork() == 0){
+    close(p[0]);
+    for(i = 0; i < nchunk; i++)
+      write(p[1], src, CHUNK);
+    exit();
+  }
+  close(p[1]);
+  for(i = 0; i < nchunk; i++)
+    for(n = 0; n < CHUNK; n += m)
+      if((m = read(p[0], dst + n, CHUNK - n)) <= 0){
+        printf(2, "shmbench: short pipe read\n");
+        exit();
+      }
+  wait();
+  t0 = rdtsc() - t0;
+  close(p[0]);
+  return t0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int kb, nchunk;
+
+  kb = argc > 1 ? atoi(argv[1]) : 1024;
+  nchunk = kb / (CHUNK/1024);
+  if(nchunk < 1){
+    printf(2, "usage: shmbench [KB to move, at least %d]\n", CHUNK/1024);
+    exit();
+  }
+  memset(src, 'x', sizeof(src));
+  printf(1, "%d KB: shm %d kcycles, pipe %d kcycles\n", nchunk*(CHUNK/1024),
+         (uint)(shmrun(nchunk) >> 10), (uint)(piperun(nchunk) >> 10));
+  exit();
+}
@@ -0,0 +1,160 @@
+// Dump per-syscall counts, cycles and log2 latency histograms.
+//
+//   sysstat            system-wide totals since boot
+//   sysstat -p pid     one process
+//   sysstat cmd args   system-wide delta while cmd runs
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "syscall.h"
+
+static char *names[NSYSCALL] = {
+[SYS_fork]    "fork",
+[SYS_exit]    "exit",
+[SYS_wait]    "wait",
+[SYS_pipe]    "pipe",
+[SYS_write]   "write",
+[SYS_read]    "read",
+[SYS_close]   "close",
+[SYS_kill]    "kill",
+[SYS_exec]    "exec",
+[SYS_open]    "open",
+[SYS_mknod]   "mknod",
+[SYS_unlink]  "unlink",
+[SYS_fstat]   "fstat",
+[SYS_link]    "link",
+[SYS_mkdir]   "mkdir",
+[SYS_chdir]   "chdir",
+[SYS_dup]     "dup",
+[SYS_getpid]  "getpid",
+[SYS_sbrk]    "sbrk",
+[SYS_sleep]   "sleep",
+[SYS_uptime]  "uptime",
+[SYS_getpri]  "getpri",
+[SYS_setpri]  "setpri",
+[SYS_getpinfo]  "getpinfo",
+[SYS_getsysstat] "getsysstat",
+[SYS_mappinfo] "mappinfo",
+[SYS_profctl] "profctl",
+[SYS_profread] "profread",
+[SYS_tracectl] "tracectl",
+[SYS_traceread] "traceread",
+[SYS_getrusage] "getrusage",
+[SYS_ringsetup] "ringsetup",
+[SYS_ringenter] "ringenter",
+[SYS_readv]   "readv",
+[SYS_writev]  "writev",
+[SYS_pread]   "pread",
+[SYS_pwrite]  "pwrite",
+[SYS_mmap]    "mmap",
+[SYS_munmap]  "munmap",
+[SYS_shmat]   "shmat",
+[SYS_shmdt]   "shmdt",
+[SYS_clone]   "clone",
+[SYS_join]    "join",
+[SYS_futexwait] "futexwait",
+[SYS_futexwake] "futexwake",
+[SYS_fadvise] "fadvise",
+[SYS_fcntl]   "fcntl",
+[SYS_poll]    "poll",
+[SYS_dmesg]   "dmesg",
+[SYS_mount]   "mount",
+};
+
+// Too big for the one-page user stack.
+static struct sysstat before, after;
+
+static void
+pad(char *s, int width)
+{
+  int n;
+
+  printf(1, "%s", s);
+  for(n = strlen(s); n < width; n++)
+    printf(1, " ");
+}
+
+// Print cycles, switching to units of 1024 once the count
+// no longer fits in printf's signed %d.
+static void
+printcycles(uint64 c, uint count)
+{
+  uint avg;
+
+  if((c >> 31) == 0){
+    avg = count ? (uint)c / count : 0;
+    printf(1, "%d\t%d\n", (uint)c, avg);
+  } else {
+    avg = count ? (uint)(c >> 10) / count : 0;
+    printf(1, "%dk\t%dk\n", (uint)(c >> 10), avg);
+  }
+}
+
+static void
+dump(struct sysstat *st)
+{
+  int n, b;
+  char *name;
+
+  printf(1, "syscall       count\tcycles\tavg\n");
+  for(n = 0; n < NSYSCALL; n++){
+    if(st->count[n] == 0)
+      continue;
+    name = names[n] ? names[n] : "?";
+    pad(name, 14);
+    printf(1, "%d\t", st->count[n]);
+    printcycles(st->cycles[n], st->count[n]);
+    printf(1, "  log2:");
+    for(b = 0; b < NSYSHIST; b++)
+      if(st->hist[n][b])
+        printf(1, " %d:%d", b, st->hist[n][b]);
+    printf(1, "\n");
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int n, b;
+
+  if(argc == 1){
+    if(getsysstat(0, &after) < 0){
+      printf(2, "sysstat: getsysstat failed\n");
+      exit();
+    }
+    dump(&after);
+    exit();
+  }
+
+  if(strcmp(argv[1], "-p") == 0){
+    if(argc != 3){
+      printf(2, "usage: sysstat [-p pid | cmd args...]\n");
+      exit();
+    }
+    if(getsysstat(atoi(argv[2]), &after) < 0){
+      printf(2, "sysstat: no process %s\n", argv[2]);
+      exit();
+    }
+    dump(&after);
+    exit();
+  }
+
+  getsysstat(0, &before);
+  if(fork() == 0){
+    exec(argv[1], argv+1);
+    printf(2, "sysstat: exec %s failed\n", argv[1]);
+    exit();
+  }
+  wait();
+  getsysstat(0, &after);
+
+  for(n = 0; n < NSYSCALL; n++){
+    after.count[n] -= before.count[n];
+    after.cycles[n] -= before.cycles[n];
+    for(b = 0; b < NSYSHIST; b++)
+      after.hist[n][b] -= before.hist[n][b];
+  }
+  dump(&after);
+  exit();
+}
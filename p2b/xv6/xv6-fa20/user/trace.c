@@ -0,0 +1,141 @@
+// Record a kernel event trace while a command runs.
+//
+//   trace cmd args...
+//
+// Prints the events as Chrome trace JSON (load it in
+// chrome://tracing or Perfetto).  Each cpu is a thread showing
+// which process ran when and its lock spins; disk requests are
+// async slices; the rest are instant events.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "x86.h"
+
+#define MAXEV (NCPU*NTRACEEV)
+
+static struct traceev ev[MAXEV];
+
+// 64 by 32-bit division; there is no libgcc for __udivdi3.
+static uint64
+div64(uint64 n, uint d)
+{
+  uint64 q, r;
+  int i;
+
+  q = r = 0;
+  for(i = 63; i >= 0; i--){
+    r = (r << 1) | ((n >> i) & 1);
+    if(r >= d){
+      r -= d;
+      q |= 1ULL << i;
+    }
+  }
+  return q;
+}
+
+// Measure rdtsc cycles per microsecond over ten
+// 10ms clock ticks.
+static uint
+calibrate(void)
+{
+  uint t, start, end, cyc;
+  uint64 c0, c1;
+
+  t = uptime();
+  while((start = uptime()) == t)
+    ;
+  c0 = rdtsc();
+  while((end = uptime()) < start + 10)
+    ;
+  c1 = rdtsc();
+  cyc = (uint)div64(c1 - c0, (end - start) * 10000);
+  return cyc ? cyc : 1;
+}
+
+static void
+event(char *name, char *ph, uint ts, int cpu)
+{
+  printf(1, ",\n{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%d,"
+         "\"pid\":0,\"tid\":%d", name, ph, ts, cpu);
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct traceev *e;
+  int pid, taken, n, i;
+  uint cyc, ts;
+  uint64 t0;
+
+  if(argc < 2){
+    printf(2, "usage: trace cmd args...\n");
+    exit();
+  }
+  cyc = calibrate();
+
+  tracectl(TRACE_RESET);
+  tracectl(TRACE_START);
+  if((pid = fork()) == 0){
+    exec(argv[1], argv+1);
+    printf(2, "trace: exec %s failed\n", argv[1]);
+    exit();
+  }
+  wait();
+  taken = tracectl(TRACE_STOP);
+  n = traceread(ev, MAXEV);
+  printf(2, "trace: %d events, %d kept, %d cycles/us\n", taken, n, cyc);
+  if(n == 0)
+    exit();
+
+  t0 = ev[0].tsc;
+  for(i = 1; i < n; i++)
+    if(ev[i].tsc < t0)
+      t0 = ev[i].tsc;
+
+  // Every event starts with a comma, so lead with a dummy.
+  printf(1, "{\"traceEvents\":[\n{\"name\":\"start\",\"ph\":\"i\","
+         "\"ts\":0,\"pid\":0,\"tid\":0}");
+  for(i = 0; i < n; i++){
+    e = &ev[i];
+    ts = (uint)div64(e->tsc - t0, cyc);
+    switch(e->type){
+    case TR_SWITCH:
+      printf(1, ",\n{\"name\":\"pid %d\",\"ph\":\"B\",\"ts\":%d,"
+             "\"pid\":0,\"tid\":%d}", e->arg, ts, e->cpu);
+      continue;
+    case TR_SCHED:
+      printf(1, ",\n{\"name\":\"pid %d\",\"ph\":\"E\",\"ts\":%d,"
+             "\"pid\":0,\"tid\":%d,\"args\":{\"state\":%d}}",
+             e->pid, ts, e->cpu, e->arg);
+      continue;
+    case TR_LOCKWAIT:
+    case TR_LOCKGOT:
+      event("lock spin", e->type == TR_LOCKWAIT ? "B" : "E", ts, e->cpu);
+      printf(1, ",\"args\":{\"lock\":\"0x%x\"}}", e->arg);
+      continue;
+    case TR_IOSTART:
+    case TR_IODONE:
+      event(e->arg & TR_WRITE ? "disk write" : "disk read",
+            e->type == TR_IOSTART ? "b" : "e", ts, e->cpu);
+      printf(1, ",\"cat\":\"disk\",\"id\":%d,\"args\":{\"sector\":%d}}",
+             e->arg & ~TR_WRITE, e->arg & ~TR_WRITE);
+      continue;
+    case TR_SLEEP:
+      event("sleep", "i", ts, e->cpu);
+      printf(1, ",\"args\":{\"pid\":%d,\"chan\":\"0x%x\"}}", e->pid, e->arg);
+      continue;
+    case TR_WAKEUP:
+      event("wakeup", "i", ts, e->cpu);
+      printf(1, ",\"args\":{\"by\":%d,\"pid\":%d}}", e->pid, e->arg);
+      continue;
+    case TR_BGET:
+    case TR_BRELSE:
+      event(e->type == TR_BGET ? "bget" : "brelse", "i", ts, e->cpu);
+      printf(1, ",\"args\":{\"pid\":%d,\"sector\":%d}}", e->pid, e->arg);
+      continue;
+    }
+  }
+  printf(1, "\n]}\n");
+  exit();
+}
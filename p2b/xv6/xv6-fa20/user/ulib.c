@@ -103,3 +103,75 @@ memmove(void *vdst, void *vsrc, int n)
     *dst++ = *src++;
   return vdst;
 }
+
+// Copy a consistent snapshot out of the page from mappinfo()
+// without a system call.  Retries while the kernel is
+// rewriting it (odd seq) or finished a rewrite mid-copy.
+void
+readpinfo(struct pstatpage *pg, struct pstat *st)
+{
+  uint seq;
+
+  for(;;){
+    while((seq = pg->seq) & 1)
+      ;
+    __sync_synchronize();
+    memmove(st, (void*)&pg->st, sizeof(*st));
+    __sync_synchronize();
+    if(pg->seq == seq)
+      return;
+  }
+}
+
+// Spin locks for threads made by thread_create().
+void
+lock_init(lock_t *lk)
+{
+  lk->locked = 0;
+}
+
+void
+lock_acquire(lock_t *lk)
+{
+  while(xchg(&lk->locked, 1) != 0)
+    ;
+}
+
+void
+lock_release(lock_t *lk)
+{
+  xchg(&lk->locked, 0);
+}
+
+// Sleeping locks.  state is 0 when unlocked, 1 when locked and
+// 2 when locked with possible waiters, so an uncontended
+// lock/unlock pair makes no system calls.
+void
+mutex_init(mutex_t *m)
+{
+  m->state = 0;
+}
+
+void
+mutex_lock(mutex_t *m)
+{
+  int s;
+
+  if((s = __sync_val_compare_and_swap(&m->state, 0, 1)) == 0)
+    return;
+  if(s != 2)
+    s = xchg((uint*)&m->state, 2);
+  while(s != 0){
+    futexwait((int*)&m->state, 2);
+    s = xchg((uint*)&m->state, 2);
+  }
+}
+
+void
+mutex_unlock(mutex_t *m)
+{
+  if(__sync_fetch_and_sub(&m->state, 1) != 1){
+    m->state = 0;
+    futexwake((int*)&m->state);
+  }
+}
@@ -3,8 +3,13 @@
 #include "user.h"
 #include "param.h"
 
-// Memory allocator by Kernighan and Ritchie,
+// Small requests come from power-of-two size classes: each class
+// is a free list of equal-sized blocks carved from sbrk'd chunks,
+// so malloc and free of small blocks are O(1).  Larger requests
+// use the first-fit allocator by Kernighan and Ritchie,
 // The C programming Language, 2nd ed.  Section 8.7.
+// Every block starts with a Header; small blocks have SMALL set
+// in s.size, with their class in the low bits.
 
 typedef long Align;
 
@@ -18,15 +23,63 @@ union header {
 
 typedef union header Header;
 
+#define NCLASS    8           // 16, 32, ... 2048 byte blocks
+#define MINSHIFT  4           // log2 of the smallest block
+#define SMALL     0x80000000  // s.size flag for size-class blocks
+#define CHUNK     4096        // bytes carved per refill
+
 static Header base;
 static Header *freep;
+static Header *bins[NCLASS];
+
+// Size class for nbytes plus header, or -1 if too big.
+static int
+sizeclass(uint nbytes)
+{
+  int c;
+
+  if(nbytes > (1 << (NCLASS-1+MINSHIFT)) - sizeof(Header))
+    return -1;
+  for(c = 0; (1 << (c+MINSHIFT)) < nbytes + sizeof(Header); c++)
+    ;
+  return c;
+}
+
+// Carve a fresh chunk into blocks of class c.
+static int
+refill(int c)
+{
+  char *p;
+  Header *hp;
+  uint size, off;
+
+  size = 1 << (c+MINSHIFT);
+  if((p = sbrk(CHUNK)) == (char*)-1)
+    return -1;
+  for(off = 0; off + size <= CHUNK; off += size){
+    hp = (Header*)(p + off);
+    hp->s.size = SMALL | c;
+    hp->s.ptr = bins[c];
+    bins[c] = hp;
+  }
+  return 0;
+}
 
 void
 free(void *ap)
 {
   Header *bp, *p;
+  int c;
 
+  if(ap == 0)
+    return;
   bp = (Header*)ap - 1;
+  if(bp->s.size & SMALL){
+    c = bp->s.size & ~SMALL;
+    bp->s.ptr = bins[c];
+    bins[c] = bp;
+    return;
+  }
   for(p = freep; !(bp > p && bp < p->s.ptr); p = p->s.ptr)
     if(p >= p->s.ptr && (bp > p || bp < p->s.ptr))
       break;
@@ -65,6 +118,15 @@ malloc(uint nbytes)
 {
   Header *p, *prevp;
   uint nunits;
+  int c;
+
+  if((c = sizeclass(nbytes)) >= 0){
+    if(bins[c] == 0 && refill(c) < 0)
+      return 0;
+    p = bins[c];
+    bins[c] = p->s.ptr;
+    return (void*)(p + 1);
+  }
 
   nunits = (nbytes + sizeof(Header) - 1)/sizeof(Header) + 1;
   if((prevp = freep) == 0){
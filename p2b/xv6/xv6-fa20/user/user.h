@@ -2,6 +2,13 @@
 #define _USER_H_
 
 #include "pstat.h"
+#include "sysstat.h"
+#include "prof.h"
+#include "trace.h"
+#include "rusage.h"
+#include "ring.h"
+#include "uio.h"
+#include "poll.h"
 
 struct stat;
 
@@ -35,17 +42,70 @@ void *memmove(void*, void*, int);
 char* strchr(const char*, char c);
 int strcmp(const char*, const char*);
 void printf(int, char*, ...);
+void fflush(int);
 char* gets(char*, int max);
 uint strlen(char*);
 void* memset(void*, int, uint);
 void* malloc(uint);
 void free(void*);
 int atoi(const char*);
+void readpinfo(struct pstatpage*, struct pstat*);
+
+// threads (ulib.c)
+typedef struct { volatile uint locked; } lock_t;
+typedef struct { volatile int state; } mutex_t;
+void lock_init(lock_t*);
+void lock_acquire(lock_t*);
+void lock_release(lock_t*);
+void mutex_init(mutex_t*);
+void mutex_lock(mutex_t*);
+void mutex_unlock(mutex_t*);
+int thread_create(void(*)(void*, void*), void*, void*);
+int thread_join(void);
 
 // P2B
 int setpri(int pid, int pri);
 int getpri(int pid);
 int getpinfo(struct pstat * status);
 
+int getsysstat(int pid, struct sysstat*);
+struct pstatpage* mappinfo(void);
+int profctl(int);
+int profread(struct profsample*, int);
+int tracectl(int);
+int traceread(struct traceev*, int);
+int getrusage(int, struct rusage*);
+struct ring* ringsetup(void);
+int ringenter(void);
+int readv(int, struct iovec*, int);
+int writev(int, struct iovec*, int);
+int pread(int, void*, int, int);
+int pwrite(int, void*, int, int);
+void* mmap(void*, int, int, int, int, int);
+int munmap(void*, int);
+void* shmat(int, int);
+int shmdt(void*);
+int clone(void(*)(void*, void*), void*, void*, void*);
+int join(void**);
+int futexwait(int*, int);
+int futexwake(int*);
+int fadvise(int, int, int, int);
+int fcntl(int, int, int);
+int poll(struct pollfd*, int, int);
+int dmesg(char*, int);
+int mount(char*, int);
+
+// unbuffered system calls wrapped by printf.c
+int _fork(void);
+int _exit(void) __attribute__((noreturn));
+int _close(int);
+int _exec(char*, char**);
+
+// SYSENTER versions of hot system calls
+int read_fast(int, void*, int);
+int write_fast(int, void*, int);
+int getpid_fast(void);
+int uptime_fast(void);
+
 #endif // _USER_H_
 
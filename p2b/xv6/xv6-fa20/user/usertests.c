@@ -3,6 +3,7 @@
 #include "user.h"
 #include "fs.h"
 #include "fcntl.h"
+#include "mman.h"
 #include "syscall.h"
 #include "traps.h"
 
@@ -1479,9 +1480,629 @@ bigargtest(void)
   wait();
 }
 
+// threads made by clone() share memory and are reaped by join()
+
+int tcount;
+mutex_t tlock;
+
+void
+threadadd(void *a, void *b)
+{
+  int i;
+
+  for(i = 0; i < (int)b; i++){
+    mutex_lock(&tlock);
+    tcount += (int)a;
+    mutex_unlock(&tlock);
+  }
+  exit();
+}
+
+void
+threadtest(void)
+{
+  void *stack;
+  int i;
+
+  printf(stdout, "thread test\n");
+  if(join(&stack) != -1){
+    printf(stdout, "join with no threads succeeded\n");
+    exit();
+  }
+  if(clone(threadadd, 0, 0, (void*)0xFFFFF000) != -1 ||
+     clone(threadadd, 0, 0, (void*)(PAGE + 1)) != -1){
+    printf(stdout, "clone with bad stack succeeded\n");
+    exit();
+  }
+  tcount = 0;
+  mutex_init(&tlock);
+  for(i = 0; i < 4; i++){
+    if(thread_create(threadadd, (void*)1, (void*)1000) < 0){
+      printf(stdout, "thread_create failed\n");
+      exit();
+    }
+  }
+  for(i = 0; i < 4; i++){
+    if(thread_join() < 0){
+      printf(stdout, "thread_join failed\n");
+      exit();
+    }
+  }
+  if(thread_join() != -1){
+    printf(stdout, "thread_join got too many\n");
+    exit();
+  }
+  if(tcount != 4000){
+    printf(stdout, "threads counted %d, want 4000\n", tcount);
+    exit();
+  }
+  printf(stdout, "thread test ok\n");
+}
+
+volatile int fword, fwoke;
+
+void
+futexwaiter(void *a, void *b)
+{
+  while(fword == 0)
+    futexwait((int*)&fword, 0);
+  fwoke = 1;
+  exit();
+}
+
+void
+futextest(void)
+{
+  printf(stdout, "futex test\n");
+  fword = fwoke = 0;
+  if(futexwait((int*)&fword, 1) != -1){
+    printf(stdout, "futexwait slept on a changed word\n");
+    exit();
+  }
+  if(thread_create(futexwaiter, 0, 0) < 0){
+    printf(stdout, "thread_create failed\n");
+    exit();
+  }
+  sleep(2);
+  if(fwoke){
+    printf(stdout, "futex waiter did not wait\n");
+    exit();
+  }
+  // Memory shared with a thread cannot shrink.
+  if(sbrk(-PAGE) != (char*)-1){
+    printf(stdout, "sbrk shrank memory shared with a thread\n");
+    exit();
+  }
+  fword = 1;
+  futexwake((int*)&fword);
+  if(thread_join() < 0 || !fwoke){
+    printf(stdout, "futex waiter did not wake\n");
+    exit();
+  }
+  printf(stdout, "futex test ok\n");
+}
+
+// cowval is in the program image, which exec caches and
+// shares copy-on-write with every process running it.
+int cowval = 1234;
+char *cowargv[] = { "usertests", "cowcheck", 0 };
+
+void
+cowtest(void)
+{
+  int fds[2], pid, n, i;
+  char b[16];
+
+  printf(stdout, "cow test\n");
+  pid = fork();
+  if(pid == 0){
+    cowval = 1;
+    exit();
+  }
+  wait();
+  if(cowval != 1234){
+    printf(stdout, "child's write reached parent\n");
+    exit();
+  }
+  cowval = 5;
+  pid = fork();
+  if(pid == 0){
+    if(cowval == 5)
+      cowval = 6;
+    exit();
+  }
+  wait();
+  if(cowval != 5){
+    printf(stdout, "child's write reached parent\n");
+    exit();
+  }
+
+  // A new exec of this program must see the original image.
+  if(pipe(fds) != 0){
+    printf(stdout, "pipe() failed\n");
+    exit();
+  }
+  pid = fork();
+  if(pid == 0){
+    close(1);
+    dup(fds[1]);
+    close(fds[0]);
+    close(fds[1]);
+    exec("usertests", cowargv);
+    printf(2, "exec usertests failed\n");
+    exit();
+  }
+  close(fds[1]);
+  for(n = 0; n < sizeof(b) - 1 && (i = read(fds[0], b + n, sizeof(b) - 1 - n)) > 0; n += i)
+    ;
+  b[n] = '\0';
+  close(fds[0]);
+  wait();
+  if(strcmp(b, "1234") != 0){
+    printf(stdout, "exec saw cowval %s, want 1234\n", b);
+    exit();
+  }
+  cowval = 1234;
+  printf(stdout, "cow test ok\n");
+}
+
+// readv() and writev() gather and scatter; pread() and pwrite()
+// leave the file offset alone
+
+void
+iovtest(void)
+{
+  struct iovec iov[2];
+  char a[5], b[9];
+  int fd;
+
+  printf(stdout, "iov test\n");
+  fd = open("iovfile", O_CREATE|O_RDWR);
+  if(fd < 0){
+    printf(stdout, "create iovfile failed\n");
+    exit();
+  }
+  iov[0].base = "abc";
+  iov[0].len = 3;
+  iov[1].base = "defgh";
+  iov[1].len = 5;
+  if(writev(fd, iov, 2) != 8){
+    printf(stdout, "writev failed\n");
+    exit();
+  }
+  if(pwrite(fd, "XY", 2, 1) != 2 || pwrite(fd, "Z", -1, 0) != -1){
+    printf(stdout, "pwrite failed\n");
+    exit();
+  }
+  if(write(fd, "i", 1) != 1){
+    printf(stdout, "pwrite moved the offset\n");
+    exit();
+  }
+  memset(b, 0, sizeof(b));
+  if(pread(fd, b, 4, 2) != 4 || strcmp(b, "Ydef") != 0){
+    printf(stdout, "pread read the wrong data\n");
+    exit();
+  }
+  close(fd);
+
+  fd = open("iovfile", O_RDONLY);
+  iov[0].base = a;
+  iov[0].len = sizeof(a) - 1;
+  iov[1].base = b;
+  iov[1].len = sizeof(b) - 1;
+  memset(a, 0, sizeof(a));
+  memset(b, 0, sizeof(b));
+  if(readv(fd, iov, 2) != 9 || strcmp(a, "aXYd") != 0 || strcmp(b, "efghi") != 0){
+    printf(stdout, "readv read the wrong data\n");
+    exit();
+  }
+  if(readv(fd, iov, 2) != 0){
+    printf(stdout, "readv past the end\n");
+    exit();
+  }
+  close(fd);
+  unlink("iovfile");
+  printf(stdout, "iov test ok\n");
+}
+
+// a process can hold more than NOFILE fds, and each new one
+// is the lowest free
+
+#define NFDTEST 100
+
+void
+fdtest(void)
+{
+  int fds[2], fd, i, pid;
+  char c;
+
+  printf(stdout, "fd test\n");
+  if(pipe(fds) != 0){
+    printf(stdout, "pipe() failed\n");
+    exit();
+  }
+  for(i = fds[1] + 1; i < NFDTEST; i++){
+    if((fd = dup(fds[1])) != i){
+      printf(stdout, "dup returned %d, want %d\n", fd, i);
+      exit();
+    }
+  }
+  close(5);
+  close(40);
+  if(dup(fds[1]) != 5 || dup(fds[1]) != 40 || dup(fds[1]) != NFDTEST){
+    printf(stdout, "dup did not return the lowest free fd\n");
+    exit();
+  }
+
+  // A child inherits the whole table.
+  pid = fork();
+  if(pid == 0){
+    write(NFDTEST - 1, "x", 1);
+    exit();
+  }
+  wait();
+  if(read(fds[0], &c, 1) != 1 || c != 'x'){
+    printf(stdout, "child could not write to a high fd\n");
+    exit();
+  }
+  for(i = fds[1] + 1; i <= NFDTEST; i++)
+    close(i);
+  close(fds[0]);
+  close(fds[1]);
+  if((fd = open("echo", 0)) != fds[0]){
+    printf(stdout, "open returned %d after closing all\n", fd);
+    exit();
+  }
+  close(fd);
+  printf(stdout, "fd test ok\n");
+}
+
+// stores through a shared mapping reach the file when it is
+// unmapped; stores through a private one never do
+
+void
+mmaptest(void)
+{
+  char *p, c;
+  int fd, i;
+
+  printf(stdout, "mmap test\n");
+  fd = open("mmapfile", O_CREATE|O_RDWR);
+  if(fd < 0){
+    printf(stdout, "create mmapfile failed\n");
+    exit();
+  }
+  memset(buf, 'a', sizeof(buf));
+  for(i = 0; i < 3; i++)
+    if(write(fd, buf, sizeof(buf)) != sizeof(buf)){
+      printf(stdout, "write mmapfile failed\n");
+      exit();
+    }
+
+  p = mmap(0, 3*sizeof(buf), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+  if(p == MAP_FAILED){
+    printf(stdout, "mmap shared failed\n");
+    exit();
+  }
+  if(p[0] != 'a' || p[3*sizeof(buf) - 1] != 'a'){
+    printf(stdout, "mapping has the wrong data\n");
+    exit();
+  }
+  p[1] = 'S';
+  p[PAGE + 1] = 'T';
+  if(munmap(p, 3*sizeof(buf)) < 0){
+    printf(stdout, "munmap failed\n");
+    exit();
+  }
+  if(pread(fd, &c, 1, 1) != 1 || c != 'S' || pread(fd, &c, 1, PAGE + 1) != 1 || c != 'T'){
+    printf(stdout, "shared stores not written back\n");
+    exit();
+  }
+
+  p = mmap(0, 3*sizeof(buf), PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+  if(p == MAP_FAILED){
+    printf(stdout, "mmap private failed\n");
+    exit();
+  }
+  if(p[1] != 'S'){
+    printf(stdout, "private mapping missed the written-back data\n");
+    exit();
+  }
+  p[1] = 'P';
+  if(pread(fd, &c, 1, 1) != 1 || c != 'S'){
+    printf(stdout, "private store reached the file\n");
+    exit();
+  }
+  munmap(p, 3*sizeof(buf));
+  if(pread(fd, &c, 1, 1) != 1 || c != 'S'){
+    printf(stdout, "private store written back\n");
+    exit();
+  }
+  close(fd);
+  unlink("mmapfile");
+  printf(stdout, "mmap test ok\n");
+}
+
+// a shm segment lives until its last attachment goes
+
+#define SHMKEY 0x537
+
+void
+shmtest(void)
+{
+  int *a, pid, fd, fds[2];
+  char *p;
+
+  printf(stdout, "shm test\n");
+  a = shmat(SHMKEY, PAGE);
+  if(a == (int*)-1){
+    printf(stdout, "shmat failed\n");
+    exit();
+  }
+  if(a[0] != 0){
+    printf(stdout, "new segment not zeroed\n");
+    exit();
+  }
+  a[0] = 42;
+  pid = fork();
+  if(pid == 0){
+    if(a[0] == 42)
+      a[0] = 43;
+    shmdt(a);
+    exit();
+  }
+  wait();
+  if(a[0] != 43){
+    printf(stdout, "fork child did not share the segment\n");
+    exit();
+  }
+  if(shmdt(a) < 0 || shmdt(a) != -1){
+    printf(stdout, "shmdt failed\n");
+    exit();
+  }
+  // The last detach freed it; attaching again makes a new one.
+  a = shmat(SHMKEY, PAGE);
+  if(a == (int*)-1 || a[0] != 0){
+    printf(stdout, "segment outlived its last detach\n");
+    exit();
+  }
+
+  // System calls take buffers and futex words in a segment.
+  pid = fork();
+  if(pid == 0){
+    a[1] = 1;
+    futexwake(&a[1]);
+    exit();
+  }
+  while(a[1] == 0)
+    futexwait(&a[1], 0);
+  wait();
+  if(futexwake(&a[1]) != 0){
+    printf(stdout, "futexwake on a segment failed\n");
+    exit();
+  }
+  if(pipe(fds) != 0){
+    printf(stdout, "pipe() failed\n");
+    exit();
+  }
+  if(write(fds[1], a, 2*sizeof(a[0])) != 2*sizeof(a[0]) ||
+     read(fds[0], &a[2], 2*sizeof(a[0])) != 2*sizeof(a[0]) || a[3] != 1){
+    printf(stdout, "read or write with a segment buffer failed\n");
+    exit();
+  }
+  // ... and in a read-only file mapping not yet touched.
+  fd = open("usertests", O_RDONLY);
+  p = mmap(0, PAGE, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(p == MAP_FAILED || write(fds[1], p, 4) != 4 ||
+     read(fds[0], &a[4], 4) != 4 || a[4] != 0x464C457F){
+    printf(stdout, "write from a file mapping failed\n");
+    exit();
+  }
+  munmap(p, PAGE);
+  close(fds[0]);
+  close(fds[1]);
+  shmdt(a);
+  printf(stdout, "shm test ok\n");
+}
+
+// fadvise() changes how a file is cached, never what is read
+
+void
+fadvisetest(void)
+{
+  int fd, fds[2], i, n, a;
+  int advice[] = { FADV_SEQUENTIAL, FADV_RANDOM, FADV_WILLNEED,
+                   FADV_DONTNEED, FADV_NORMAL };
+
+  printf(stdout, "fadvise test\n");
+  fd = open("fadvfile", O_CREATE|O_RDWR);
+  if(fd < 0){
+    printf(stdout, "create fadvfile failed\n");
+    exit();
+  }
+  for(i = 0; i < 10; i++){
+    memset(buf, i, sizeof(buf));
+    if(write(fd, buf, sizeof(buf)) != sizeof(buf)){
+      printf(stdout, "write fadvfile failed\n");
+      exit();
+    }
+  }
+  close(fd);
+
+  for(a = 0; a < sizeof(advice)/sizeof(advice[0]); a++){
+    fd = open("fadvfile", O_RDONLY);
+    if(fadvise(fd, 0, 0, advice[a]) != 0){
+      printf(stdout, "fadvise %d failed\n", advice[a]);
+      exit();
+    }
+    for(i = 0; (n = read(fd, buf, sizeof(buf))) > 0; i++){
+      if(n != sizeof(buf) || buf[0] != i || buf[n-1] != i){
+        printf(stdout, "read wrong data after fadvise %d\n", advice[a]);
+        exit();
+      }
+    }
+    if(i != 10){
+      printf(stdout, "read %d blocks after fadvise %d\n", i, advice[a]);
+      exit();
+    }
+    close(fd);
+  }
+
+  fd = open("fadvfile", O_RDONLY);
+  if(fadvise(fd, 0, 0, 99) != -1 || fadvise(fd, -1, 0, FADV_NORMAL) != -1){
+    printf(stdout, "fadvise accepted bad arguments\n");
+    exit();
+  }
+  close(fd);
+  if(pipe(fds) != 0 || fadvise(fds[0], 0, 0, FADV_WILLNEED) != -1){
+    printf(stdout, "fadvise on a pipe did not fail\n");
+    exit();
+  }
+  close(fds[0]);
+  close(fds[1]);
+  unlink("fadvfile");
+  printf(stdout, "fadvise test ok\n");
+}
+
+// non-blocking pipe reads and writes, and poll()
+
+void
+polltest(void)
+{
+  int fds[2], pid, n, i;
+  struct pollfd pfd[2];
+  char c;
+
+  printf(stdout, "poll test\n");
+  if(pipe(fds) != 0){
+    printf(stdout, "pipe() failed\n");
+    exit();
+  }
+  if(fcntl(fds[0], F_SETFL, O_NONBLOCK) < 0 ||
+     fcntl(fds[1], F_SETFL, O_NONBLOCK) < 0 ||
+     fcntl(fds[0], F_GETFL, 0) != (O_RDONLY|O_NONBLOCK)){
+    printf(stdout, "fcntl failed\n");
+    exit();
+  }
+  if(read(fds[0], &c, 1) != -1){
+    printf(stdout, "non-blocking read of empty pipe did not fail\n");
+    exit();
+  }
+  pfd[0].fd = fds[0];
+  pfd[0].events = POLLIN;
+  pfd[1].fd = fds[1];
+  pfd[1].events = POLLOUT;
+  if(poll(pfd, 2, 0) != 1 || pfd[0].revents != 0 || pfd[1].revents != POLLOUT){
+    printf(stdout, "poll of empty pipe wrong\n");
+    exit();
+  }
+
+  // Non-blocking writes stop when the pipe fills.
+  for(n = 0; (i = write(fds[1], buf, sizeof(buf))) > 0; n += i)
+    ;
+  if(n == 0 || n >= sizeof(buf)){
+    printf(stdout, "non-blocking writes wrote %d\n", n);
+    exit();
+  }
+  if(poll(pfd, 2, 0) != 1 || pfd[0].revents != POLLIN || pfd[1].revents != 0){
+    printf(stdout, "poll of full pipe wrong\n");
+    exit();
+  }
+  while((i = read(fds[0], buf, sizeof(buf))) > 0)
+    n -= i;
+  if(n != 0){
+    printf(stdout, "read back the wrong count\n");
+    exit();
+  }
+
+  // poll() waits for a writer, then sees it hang up.
+  pid = fork();
+  if(pid == 0){
+    sleep(2);
+    write(fds[1], "x", 1);
+    exit();
+  }
+  close(fds[1]);
+  if(poll(pfd, 1, 1000) != 1 || !(pfd[0].revents & POLLIN) || read(fds[0], &c, 1) != 1){
+    printf(stdout, "poll did not wake for a write\n");
+    exit();
+  }
+  wait();
+  if(poll(pfd, 1, 1000) != 1 || !(pfd[0].revents & POLLHUP) || read(fds[0], &c, 1) != 0){
+    printf(stdout, "poll did not see the writer close\n");
+    exit();
+  }
+  close(fds[0]);
+  printf(stdout, "poll test ok\n");
+}
+
+// init mounts the RAM disk on /tmp; ".." leads back out of it
+
+void
+mounttest(void)
+{
+  struct stat root, st;
+  int fd;
+
+  printf(stdout, "mount test\n");
+  if(stat("/", &root) < 0 || stat("/tmp", &st) < 0 || st.dev != RAMDEV ||
+     st.type != T_DIR){
+    printf(stdout, "/tmp is not mounted\n");
+    exit();
+  }
+  if(mkdir("mntdir") != 0){
+    printf(stdout, "mkdir mntdir failed\n");
+    exit();
+  }
+  if(mount("mntdir", RAMDEV) != -1 || mount("/tmp", RAMDEV) != -1 ||
+     mount("mntdir", 0) != -1 || mount("mntdir", 99) != -1 ||
+     mount("/", RAMDEV) != -1 || mount("usertests", RAMDEV) != -1){
+    printf(stdout, "mount accepted a bad directory or device\n");
+    exit();
+  }
+  unlink("mntdir");
+
+  fd = open("/tmp/mntfile", O_CREATE|O_RDWR);
+  if(fd < 0 || write(fd, "ram", 3) != 3 || fstat(fd, &st) < 0 || st.dev != RAMDEV){
+    printf(stdout, "create on /tmp failed\n");
+    exit();
+  }
+  close(fd);
+  if(link("/tmp/mntfile", "mntlink") != -1){
+    printf(stdout, "link across the mount did not fail\n");
+    exit();
+  }
+
+  if(stat("/tmp/..", &st) < 0 || st.dev != root.dev || st.ino != root.ino){
+    printf(stdout, "/tmp/.. is not /\n");
+    exit();
+  }
+  if(chdir("/tmp") < 0 || (fd = open("../usertests", O_RDONLY)) < 0){
+    printf(stdout, "open ../usertests from /tmp failed\n");
+    exit();
+  }
+  close(fd);
+  if(chdir("..") < 0 || stat(".", &st) < 0 || st.dev != root.dev || st.ino != root.ino){
+    printf(stdout, "chdir .. from /tmp did not reach /\n");
+    exit();
+  }
+  if(unlink("/tmp/mntfile") < 0){
+    printf(stdout, "unlink /tmp/mntfile failed\n");
+    exit();
+  }
+  printf(stdout, "mount test ok\n");
+}
+
 int
 main(int argc, char *argv[])
 {
+  // exec'd by cowtest()
+  if(argc > 1 && strcmp(argv[1], "cowcheck") == 0){
+    printf(1, "%d", cowval);
+    exit();
+  }
+
   printf(1, "usertests starting\n");
 
   if(open("usertests.ran", 0) >= 0){
@@ -1499,6 +2120,10 @@ main(int argc, char *argv[])
   writetest();
   writetest1();
   createtest();
+  iovtest();
+  fdtest();
+  mmaptest();
+  fadvisetest();
 
   mem();
   pipe1();
@@ -1518,6 +2143,12 @@ main(int argc, char *argv[])
   dirfile();
   iref();
   forktest();
+  threadtest();
+  futextest();
+  cowtest();
+  shmtest();
+  polltest();
+  mounttest();
   bigdir(); // slow
 
   exectest();
@@ -0,0 +1,58 @@
+// thread_create() and thread_join(), kept out of ulib.c because
+// they need malloc, which forktest does not link.
+
+#include "types.h"
+#include "user.h"
+
+#define TPGSIZE 4096
+#define NTHREAD 64
+
+// malloc'd blocks holding the stacks of running threads; clone()
+// wants a page-aligned stack, so each block is two pages.
+static struct {
+  void *stack;
+  void *mem;
+} tstacks[NTHREAD];
+
+// Run fcn(arg1, arg2) in a new thread sharing this address space.
+// Returns the thread's pid, or -1.  Not safe to call from two
+// threads at once, as malloc is not.
+int
+thread_create(void (*fcn)(void*, void*), void *arg1, void *arg2)
+{
+  void *mem, *stack;
+  int i, pid;
+
+  for(i = 0; i < NTHREAD; i++)
+    if(tstacks[i].mem == 0)
+      break;
+  if(i == NTHREAD || (mem = malloc(2*TPGSIZE)) == 0)
+    return -1;
+  stack = (void*)(((uint)mem + TPGSIZE - 1) & ~(TPGSIZE - 1));
+  if((pid = clone(fcn, arg1, arg2, stack)) < 0){
+    free(mem);
+    return -1;
+  }
+  tstacks[i].stack = stack;
+  tstacks[i].mem = mem;
+  return pid;
+}
+
+// Wait for a thread to exit and free its stack.  Returns its pid,
+// or -1 if there are no threads.
+int
+thread_join(void)
+{
+  void *stack;
+  int i, pid;
+
+  if((pid = join(&stack)) < 0)
+    return -1;
+  for(i = 0; i < NTHREAD; i++)
+    if(tstacks[i].mem && tstacks[i].stack == stack){
+      free(tstacks[i].mem);
+      tstacks[i].mem = 0;
+      break;
+    }
+  return pid;
+}